@@ -7,92 +7,527 @@
 #include <stdexcept>
 #include <utility>      // For std::pair, std::make_pair
 #include <iterator>     // For iterator tags
-#include <algorithm>    // For std::find_if
-#include <map>          // Optional: For faster name lookup
+#include <algorithm>    // For std::max
+#include <atomic>       // For the dirty-index flag
+#include <cstddef>      // For size_t
+#include <functional>   // For std::hash
+#include <mutex>        // For settling the name index from const lookups
+#include <type_traits>  // For the const iterator's member types
 
 // Forward declaration
 template <typename T>
 class MyVector;
 
 // Define a helper struct/class to hold the actual data and manage CoW state
+//
+// Elements are stored in fixed-size blocks of kBlockSize, reached through a
+// spine of reference-counted block pointers: element i is slot i % kBlockSize
+// of block i / kBlockSize, so indexing stays O(1) (two loads instead of one).
+// Copying MyVectorData (what detach() does) copies only the spine and shares
+// every block; a block is cloned the first time it is written while another
+// copy still holds it. Writing one element of a million-element snapshot thus
+// copies the spine (a pointer per kBlockSize elements) and one block, not a
+// million strings.
+//
+// Name lookup goes through an open-addressing hash index (linear probing, at
+// most half full) from each name to the index of its first element. A slot
+// stores the name's hash and the element's index, never the name itself, so
+// the index costs three words per distinct name (with the count of elements
+// carrying it) and probing compares strings only on a hash match. It is shared
+// between copies like the blocks are, and cloned only when one copy changes
+// its names.
+//
+// push_back(), clear() and MyVector::set_name() keep the index up to date as
+// they go. Names can also be changed through the references handed out by the
+// non-const operator[](size_type) and iterators, which the index cannot see:
+// handing one out notes the element, and the next lookup re-checks the noted
+// elements only (or rebuilds the index, once very many are noted).
 template <typename T>
 struct MyVectorData {
+    using value_type = std::pair<T, std::string>;
+    using Block = std::vector<value_type>; // Every block but the last holds exactly kBlockSize elements
+
+    static constexpr size_t kNoPosition = static_cast<size_t>(-1);
+    static constexpr size_t kBlockShift = 6; // 64 elements: cheap to clone, short spine
+    static constexpr size_t kBlockSize = size_t{1} << kBlockShift;
+    static constexpr size_t kBlockMask = kBlockSize - 1;
+
     // Store elements and names together
-    std::vector<std::pair<T, std::string>> items;
-    // Optional: Add a map for faster name lookup if needed
-    // std::map<std::string, size_t> name_to_first_index; // Or unordered_multimap
+    std::vector<std::shared_ptr<Block>> blocks;
+    size_t count = 0; // Elements in all blocks
 
     // Default constructor
     MyVectorData() = default;
 
     // Copy constructor (used when detaching for CoW)
-    MyVectorData(const MyVectorData& other) : items(other.items) {
-        // If using the optional map, copy or rebuild it here
-        // build_name_map(); // Example if map needs rebuilding
+    // Shares the blocks and the index; whichever copy writes first clones them.
+    MyVectorData(const MyVectorData& other) : blocks(other.blocks), count(other.count) {
+        std::lock_guard<std::mutex> lock(other.index_mutex); // A const lookup may be settling it
+        if (other.index_dirty.load(std::memory_order_relaxed) && !other.index_stale) {
+            other.settle_index_locked(); // Then the copy starts with nothing to re-check
+        }
+        index = other.index;
+        index_stale = other.index_stale;
+        index_dirty.store(index_stale, std::memory_order_relaxed);
+    }
+
+    MyVectorData& operator=(const MyVectorData&) = delete; // Never needed: CoW replaces the whole object
+
+    // --- Elements ---
+
+    const value_type& item(size_t position) const {
+        return (*blocks[position >> kBlockShift])[position & kBlockMask];
+    }
+
+    // The element at position, in a block this copy owns alone.
+    value_type& writable_item(size_t position) {
+        return writable_block(position >> kBlockShift)[position & kBlockMask];
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if ((count & kBlockMask) == 0) {
+            // The last block is full (or there is none): start a new one
+            auto block = std::make_shared<Block>();
+            block->reserve(kBlockSize);
+            block->emplace_back(std::forward<Args>(args)...);
+            blocks.push_back(std::move(block));
+        } else {
+            writable_block(blocks.size() - 1).emplace_back(std::forward<Args>(args)...);
+        }
+        ++count;
+    }
+
+    void clear() {
+        blocks.clear(); // Blocks still held by other copies stay alive for them
+        count = 0;
+    }
+
+    void reserve(size_t new_cap) {
+        blocks.reserve((new_cap + kBlockMask) >> kBlockShift); // Blocks reserve their own room when created
+    }
+
+    // --- Name index ---
+
+    // Index of the first element called name, or kNoPosition.
+    size_t find_first(const std::string& name) const {
+        settle_index();
+        if (!index || index->slots.empty()) {
+            return kNoPosition;
+        }
+        return index->slots[find_slot(name, hash_name(name))].position;
+    }
+
+    // The element at position, writable, for a reference handed out to the
+    // caller, who may rename it: the position and the hash of its current
+    // name are noted (no copy of the name), and the next use of the index
+    // re-checks just those elements. Past a limit it is cheaper to rebuild
+    // the index once than to re-check them all.
+    value_type& touch_item(size_t position) {
+        if (!index_stale) {
+            if (!touched.empty() && touched.back().first == position) {
+                // Noted already, and only the earliest note counts
+            } else if (touched.size() < std::max<size_t>(kMinTouched, count >> kTouchedShift)) {
+                touched.emplace_back(position, hash_name(item(position).second));
+            } else {
+                index_stale = true;
+                touched.clear();
+            }
+            index_dirty.store(true, std::memory_order_relaxed);
+        }
+        return writable_item(position);
+    }
+
+    // Call after appending the last element.
+    void index_push_back() {
+        if (index_stale) {
+            return; // The next lookup rebuilds the whole index anyway
+        }
+        settle_index();
+        own_index();
+        size_t position = count - 1;
+        insert_first(item(position).second, position);
+    }
+
+    // Call after clearing the elements.
+    void index_clear() {
+        index.reset();
+        touched.clear();
+        index_stale = false;
+        index_dirty.store(false, std::memory_order_relaxed);
+    }
+
+    // Makes room for the names of new_cap elements without rehashing.
+    void index_reserve(size_t new_cap) {
+        if (index_stale) {
+            return;
+        }
+        settle_index();
+        own_index();
+        if (new_cap * 2 > index->slots.size()) {
+            rehash(slot_count_for(new_cap));
+        }
     }
 
-    // Optional: Helper to build/update the name map
-    /*
-    void build_name_map() {
-        name_to_first_index.clear();
-        for (size_t i = 0; i < items.size(); ++i) {
-            // Only insert if the name is not already present (for first occurrence)
-            name_to_first_index.try_emplace(items[i].second, i);
+    // Renames the element at position, updating the index in place.
+    void rename(size_t position, const std::string& name) {
+        if (index_stale) {
+            writable_item(position).second = name;
+            return;
         }
+        settle_index();
+        if (item(position).second == name) {
+            return;
+        }
+        own_index();
+        const std::string& old_name = item(position).second;
+        size_t slot = find_slot(old_name, hash_name(old_name));
+        remove_occurrence(slot, position, [&](size_t next) { return item(next).second == old_name; });
+        writable_item(position).second = name; // old_name is not used past here
+        insert_first(name, position);
     }
-    */
+
+private:
+    static constexpr size_t kMinTouched = 64;  // Touched elements always re-checked one by one...
+    static constexpr size_t kTouchedShift = 3; // ...or up to an eighth of all elements, if more
+
+    struct IndexSlot {
+        size_t hash = 0;
+        size_t position = kNoPosition; // First element with the name; kNoPosition marks an empty slot
+        size_t count = 0;              // Elements with the name
+    };
+
+    struct NameIndex {
+        std::vector<IndexSlot> slots; // Size is zero or a power of two
+        size_t count = 0;             // Occupied slots, i.e. distinct names
+        bool hash_collision = false;  // Two distinct names with one hash went in
+    };
+
+    // Clones the block if another copy still holds it.
+    Block& writable_block(size_t b) {
+        std::shared_ptr<Block>& block = blocks[b];
+        if (block.use_count() > 1) {
+            auto copy = std::make_shared<Block>();
+            copy->reserve(kBlockSize);
+            copy->insert(copy->end(), block->begin(), block->end());
+            block = std::move(copy);
+        }
+        return *block;
+    }
+
+    // Before changing the index: clones it if another copy still holds it.
+    void own_index() const {
+        if (!index) {
+            index = std::make_shared<NameIndex>();
+        } else if (index.use_count() > 1) {
+            index = std::make_shared<NameIndex>(*index);
+        }
+    }
+
+    // Brings the index up to date with the touched elements (see touch_item()).
+    // Const lookups may run in several threads at once, so this happens under
+    // a lock; once the index is settled, lookups take no lock.
+    void settle_index() const {
+        if (index_dirty.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(index_mutex);
+            if (index_dirty.load(std::memory_order_relaxed)) {
+                settle_index_locked();
+            }
+        }
+    }
+
+    // settle_index() for a caller holding index_mutex.
+    void settle_index_locked() const {
+        if (index_stale) {
+            rebuild_index();
+        } else {
+            recheck_touched();
+        }
+        index_stale = false;
+        touched.clear();
+        index_dirty.store(false, std::memory_order_release);
+    }
+
+    // Moves every touched element whose name changed from its old name's
+    // entry to its new one. Elements are re-checked in position order; until
+    // its turn comes, an element still counts under its old name (see
+    // pending_hash()), so the index always agrees with some set of names.
+    // Old names are known by their hash only. If two names in the index share
+    // a hash, the index is rebuilt instead; a rename to a different name with
+    // the same hash as the old one goes unseen, which std::hash makes as
+    // unlikely as any full 64-bit collision.
+    void recheck_touched() const {
+        if (touched.empty()) {
+            return;
+        }
+        if (!index || index->hash_collision) {
+            rebuild_index();
+            return;
+        }
+        auto by_position = [](const Touched& a, const Touched& b) { return a.first < b.first; };
+        auto same_position = [](const Touched& a, const Touched& b) { return a.first == b.first; };
+        std::stable_sort(touched.begin(), touched.end(), by_position);
+        // The earliest note of each element has the name the index knows it by
+        touched.erase(std::unique(touched.begin(), touched.end(), same_position), touched.end());
+        own_index();
+        for (recheck_next = 0; recheck_next < touched.size();) {
+            size_t position = touched[recheck_next].first;
+            size_t old_hash = touched[recheck_next].second;
+            const std::string& name = item(position).second;
+            if (hash_name(name) == old_hash) {
+                ++recheck_next;
+                continue;
+            }
+            remove_occurrence(find_slot_by_hash(old_hash), position,
+                              [&](size_t next) { return indexed_hash(next) == old_hash; });
+            ++recheck_next; // From here on the element reads as its new name
+            insert_first(name, position);
+            if (index->hash_collision) {
+                recheck_next = kNoPosition;
+                rebuild_index();
+                return;
+            }
+        }
+        recheck_next = kNoPosition;
+    }
+
+    // The hash of the name the index knows a touched element by, if
+    // recheck_touched() has not reached it yet; otherwise null.
+    const size_t* pending_hash(size_t position) const {
+        if (recheck_next == kNoPosition) {
+            return nullptr;
+        }
+        auto pending = std::lower_bound(touched.begin() + recheck_next, touched.end(), position,
+                                        [](const Touched& t, size_t p) { return t.first < p; });
+        return pending != touched.end() && pending->first == position ? &pending->second : nullptr;
+    }
+
+    // The hash of the name the index knows the element at position by.
+    size_t indexed_hash(size_t position) const {
+        const size_t* pending = pending_hash(position);
+        return pending != nullptr ? *pending : hash_name(item(position).second);
+    }
+
+    // Whether the element at position, whose name has the hash of name, is
+    // indexed under name. A touched element not re-checked yet is, by hash.
+    bool indexed_as(size_t position, const std::string& name) const {
+        return pending_hash(position) != nullptr || item(position).second == name;
+    }
+
+    static size_t hash_name(const std::string& name) {
+        return std::hash<std::string>{}(name);
+    }
+
+    // Power of two with room for count names at a load factor of at most 1/2.
+    static size_t slot_count_for(size_t count) {
+        size_t slots = 16;
+        while (slots < count * 2) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    // The slot holding name, or the empty slot where it belongs.
+    size_t find_slot(const std::string& name, size_t hash) const {
+        const std::vector<IndexSlot>& slots = index->slots;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const IndexSlot& slot = slots[i];
+            if (slot.position == kNoPosition || (slot.hash == hash && indexed_as(slot.position, name))) {
+                return i;
+            }
+        }
+    }
+
+    // The slot of the one name with the given hash (see recheck_touched()).
+    size_t find_slot_by_hash(size_t hash) const {
+        const std::vector<IndexSlot>& slots = index->slots;
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].hash != hash) { // The name is in the index
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // Counts position as an element called name, and records it as the first
+    // one unless an earlier one is. The index must be owned (see own_index()).
+    void insert_first(const std::string& name, size_t position) const {
+        if ((index->count + 1) * 2 > index->slots.size()) {
+            rehash(std::max<size_t>(16, index->slots.size() * 2));
+        }
+        size_t hash = hash_name(name);
+        std::vector<IndexSlot>& slots = index->slots;
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        // find_slot(), noting any other name with the same hash on the way
+        while (slots[i].position != kNoPosition && !(slots[i].hash == hash && indexed_as(slots[i].position, name))) {
+            index->hash_collision |= slots[i].hash == hash;
+            i = (i + 1) & mask;
+        }
+        IndexSlot& slot = slots[i];
+        if (slot.position == kNoPosition) {
+            slot.hash = hash;
+            slot.position = position;
+            ++index->count;
+        } else if (position < slot.position) {
+            slot.position = position;
+        }
+        ++slot.count;
+    }
+
+    // Uncounts position as an element with the name of slot i. The slot goes
+    // when its last element does; if position was the first of several, the
+    // next one takes over, found by scanning forward only as far as it
+    // (same_name(next) tells whether element next has the name).
+    // The index must be owned (see own_index()).
+    template <typename SameName>
+    void remove_occurrence(size_t i, size_t position, SameName same_name) const {
+        IndexSlot& slot = index->slots[i];
+        if (--slot.count == 0) {
+            erase_slot(i);
+        } else if (slot.position == position) {
+            size_t next = position + 1;
+            while (next < count && !same_name(next)) { // Exists, as slot.count elements remain...
+                ++next;
+            }
+            if (next < count) {
+                slot.position = next;
+            } else {
+                erase_slot(i); // ...unless a rename was missed (see recheck_touched())
+            }
+        }
+    }
+
+    // Empties a slot, shifting later entries of the probe run back so that
+    // lookups never stop at a hole (no tombstones needed).
+    void erase_slot(size_t hole) const {
+        std::vector<IndexSlot>& slots = index->slots;
+        size_t mask = slots.size() - 1;
+        for (size_t i = (hole + 1) & mask; slots[i].position != kNoPosition; i = (i + 1) & mask) {
+            size_t home = slots[i].hash & mask;
+            // The entry at i may move back unless its home lies cyclically in (hole, i].
+            bool stays = hole < i ? (home > hole && home <= i) : (home > hole || home <= i);
+            if (!stays) {
+                slots[hole] = slots[i];
+                hole = i;
+            }
+        }
+        slots[hole] = IndexSlot{};
+        --index->count;
+    }
+
+    // Moves every entry into a table of slot_count slots. Names are distinct
+    // and their hashes stored, so no string is hashed or compared.
+    void rehash(size_t slot_count) const {
+        std::vector<IndexSlot> old(slot_count);
+        old.swap(index->slots);
+        std::vector<IndexSlot>& slots = index->slots;
+        size_t mask = slot_count - 1;
+        for (const IndexSlot& slot : old) {
+            if (slot.position != kNoPosition) {
+                size_t i = slot.hash & mask;
+                while (slots[i].position != kNoPosition) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    void rebuild_index() const {
+        index = std::make_shared<NameIndex>(); // Never modify one other copies may share
+        index->slots.assign(slot_count_for(count), IndexSlot{});
+        for (size_t i = 0; i < count; ++i) {
+            insert_first(item(i).second, i);
+        }
+    }
+
+    using Touched = std::pair<size_t, size_t>; // Position of a touched element, and its name's hash then
+
+    // Mutable because a const lookup may settle the index.
+    mutable std::shared_ptr<NameIndex> index; // Null until the first name goes in
+    mutable std::vector<Touched> touched;     // Elements to re-check (see touch_item())
+    mutable bool index_stale = false;         // Too many were touched: rebuild instead
+    mutable size_t recheck_next = kNoPosition; // Progress of recheck_touched(), if running
+    mutable std::atomic<bool> index_dirty{false}; // touched is not empty, or index_stale is set
+    mutable std::mutex index_mutex;
 };
 
 // Iterator class (simplified example, could be more robust)
 // Needed to satisfy begin()/end() requirements and provide vector-like iteration
+// MyVectorIterator<T> is the mutable iterator and MyVectorIterator<const T> the
+// const one. An iterator is a position in the blocks; the mutable one clones a
+// shared block only when an element of it is dereferenced.
 template <typename T>
 class MyVectorIterator {
+    using element_type = typename std::remove_const<T>::type;
+    using data_type = typename std::conditional<std::is_const<T>::value, const MyVectorData<element_type>,
+                                                MyVectorData<element_type>>::type;
+
 public:
     // --- Member types required by C++ standard iterators ---
     using iterator_category = std::random_access_iterator_tag;
-    using value_type = std::pair<T, std::string>;
+    using value_type = std::pair<element_type, std::string>;
     using difference_type = std::ptrdiff_t;
-    using pointer = value_type*;
-    using reference = value_type&;
-    // --- Non-standard, but useful ---
-    using vector_iterator = typename std::vector<value_type>::iterator;
+    using pointer = typename std::conditional<std::is_const<T>::value, const value_type*, value_type*>::type;
+    using reference = typename std::conditional<std::is_const<T>::value, const value_type&, value_type&>::type;
 
 private:
-    vector_iterator m_iter; // Internal iterator for the vector
+    data_type* m_data = nullptr; // The vector's data (null for a default-constructed iterator)
+    size_t m_pos = 0;            // Position of the element within it
+
+    static const value_type& access(const MyVectorData<element_type>* data, size_t position) {
+        return data->item(position);
+    }
+    static value_type& access(MyVectorData<element_type>* data, size_t position) {
+        return data->touch_item(position); // Copy-on-write of the element's block; the name may change
+    }
+
+    template <typename> friend class MyVectorIterator; // For the conversion below
 
 public:
     // Constructor
-    MyVectorIterator(vector_iterator it) : m_iter(it) {}
+    MyVectorIterator() = default;
+    MyVectorIterator(data_type* data, size_t position) : m_data(data), m_pos(position) {}
+
+    // A mutable iterator converts to a const one, as std::vector's do
+    template <typename U, typename = typename std::enable_if<std::is_const<T>::value &&
+                                                             std::is_same<U, element_type>::value>::type>
+    MyVectorIterator(const MyVectorIterator<U>& other) : m_data(other.m_data), m_pos(other.m_pos) {}
 
     // Dereference
-    reference operator*() const { return *m_iter; }
-    pointer operator->() const { return &(*m_iter); }
+    reference operator*() const { return access(m_data, m_pos); }
+    pointer operator->() const { return &access(m_data, m_pos); }
 
     // Increment/Decrement
-    MyVectorIterator& operator++() { ++m_iter; return *this; }
+    MyVectorIterator& operator++() { ++m_pos; return *this; }
     MyVectorIterator operator++(int) { MyVectorIterator temp = *this; ++(*this); return temp; }
-    MyVectorIterator& operator--() { --m_iter; return *this; }
+    MyVectorIterator& operator--() { --m_pos; return *this; }
     MyVectorIterator operator--(int) { MyVectorIterator temp = *this; --(*this); return temp; }
 
     // Arithmetic
-    MyVectorIterator& operator+=(difference_type n) { m_iter += n; return *this; }
-    MyVectorIterator operator+(difference_type n) const { return MyVectorIterator(m_iter + n); }
+    MyVectorIterator& operator+=(difference_type n) { m_pos += n; return *this; }
+    MyVectorIterator operator+(difference_type n) const { return MyVectorIterator(m_data, m_pos + n); }
     friend MyVectorIterator operator+(difference_type n, const MyVectorIterator& it) { return it + n; } // Non-member friend
 
-    MyVectorIterator& operator-=(difference_type n) { m_iter -= n; return *this; }
-    MyVectorIterator operator-(difference_type n) const { return MyVectorIterator(m_iter - n); }
-    difference_type operator-(const MyVectorIterator& other) const { return m_iter - other.m_iter; }
+    MyVectorIterator& operator-=(difference_type n) { m_pos -= n; return *this; }
+    MyVectorIterator operator-(difference_type n) const { return MyVectorIterator(m_data, m_pos - n); }
 
-    // Comparison
-    bool operator==(const MyVectorIterator& other) const { return m_iter == other.m_iter; }
-    bool operator!=(const MyVectorIterator& other) const { return m_iter != other.m_iter; }
-    bool operator<(const MyVectorIterator& other) const { return m_iter < other.m_iter; }
-    bool operator>(const MyVectorIterator& other) const { return m_iter > other.m_iter; }
-    bool operator<=(const MyVectorIterator& other) const { return m_iter <= other.m_iter; }
-    bool operator>=(const MyVectorIterator& other) const { return m_iter >= other.m_iter; }
+    // Difference and comparison are non-member friends, so a mutable and a
+    // const iterator mix (the mutable one converts)
+    friend difference_type operator-(const MyVectorIterator& a, const MyVectorIterator& b) {
+        return static_cast<difference_type>(a.m_pos) - static_cast<difference_type>(b.m_pos);
+    }
+    friend bool operator==(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos == b.m_pos; }
+    friend bool operator!=(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos != b.m_pos; }
+    friend bool operator<(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos < b.m_pos; }
+    friend bool operator>(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos > b.m_pos; }
+    friend bool operator<=(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos <= b.m_pos; }
+    friend bool operator>=(const MyVectorIterator& a, const MyVectorIterator& b) { return a.m_pos >= b.m_pos; }
 
     // Offset dereference
-    reference operator[](difference_type n) const { return m_iter[n]; }
+    reference operator[](difference_type n) const { return access(m_data, m_pos + n); }
 };
 
 
@@ -106,26 +541,25 @@ public:
     using pointer = value_type*;
     using const_pointer = const value_type*;
     using iterator = MyVectorIterator<T>; // Use our custom iterator
-    using const_iterator = MyVectorIterator<const T>; // Need a const version too (simplified here)
-    // Read that a full const_iterator implementation is more involved if T itself needs constness propagation.
-    // For simplicity, this example might need refinement for a fully const-correct const_iterator.
+    using const_iterator = MyVectorIterator<const T>; // Yields const references to the pairs
     using size_type = typename std::vector<value_type>::size_type;
     using difference_type = typename std::vector<value_type>::difference_type;
     // Add other types like reverse_iterator if needed
 
 private:
-    // Shared pointer to the actual data (vector of pairs)
+    // Shared pointer to the actual data (blocks of pairs and the name index)
     std::shared_ptr<MyVectorData<T>> m_data;
 
     // --- Copy-on-Write Helper ---
     // Ensures unique ownership before modification.
-    // If the data is shared (ref count > 1), it creates a deep copy.
+    // If the data is shared (ref count > 1), it creates a copy that shares the
+    // blocks; single blocks are cloned later, when they are written.
     void detach() {
         if (!m_data) { // Handle case where vector was moved-from or default constructed
              m_data = std::make_shared<MyVectorData<T>>();
         } else if (m_data.use_count() > 1) {
             // More than one MyVector shares this data, create a copy
-            m_data = std::make_shared<MyVectorData<T>>(*m_data); // Deep copy happens here
+            m_data = std::make_shared<MyVectorData<T>>(*m_data); // Copies the spine, not the elements
         }
         // Now m_data points to a unique copy (or was already unique)
     }
@@ -161,10 +595,10 @@ public:
     const_reference operator[](size_type index) const {
         // shared_ptr provides thread-safe access to the managed object if no modifications occur.
         // I've read that bounds checking'srecommended for robustness, similar to std::vector::at()
-        if (index >= m_data->items.size()) {
+        if (index >= m_data->count) {
              throw std::out_of_range("Index out of range");
         }
-        return m_data->items[index];
+        return m_data->item(index);
     }
 
     // operator[](int index) - non-const version (Requirement 4)
@@ -172,32 +606,24 @@ public:
     reference operator[](size_type index) {
         detach(); // Ensure unique copy before allowing modification
         // Bounds checking
-        if (index >= m_data->items.size()) {
+        if (index >= m_data->count) {
              throw std::out_of_range("Index out of range");
         }
-        // If using an optional name map, modification here might require updating the map
-        // m_data->update_map_for_item(index); // Example
-        return m_data->items[index];
+        // The caller may rename the element through the reference, so the name
+        // index re-checks it at the next lookup (set_name() avoids this)
+        return m_data->touch_item(index); // Clones the element's block if it is shared
     }
 
     // operator[](const std::string& name) - const version 
     // Returns reference to the *first* T found with the given name.
-    // Complexity: O(N) without optimization, potentially O(log N) or O(1) with map.
+    // Complexity: O(1) on average through the name index, plus re-checking
+    // the elements handed out by reference since the last lookup.
     const T& operator[](const std::string& name) const {
-        // Use std::find_if for searching within the vector of pairs
-        auto it = std::find_if(m_data->items.cbegin(), m_data->items.cend(),
-                               [&name](const value_type& element) {
-                                   return element.second == name; // Compare name part of pair
-                               });
-
-        if (it == m_data->items.cend()) {
+        size_t position = m_data->find_first(name);
+        if (position == MyVectorData<T>::kNoPosition) {
             throw std::invalid_argument("Name not found in MyVector: " + name);
         }
-        return it->first; // Return const reference to the T part of the pair
-        // Optional: If using name_to_first_index map:
-        // auto map_it = m_data->name_to_first_index.find(name);
-        // if (map_it == m_data->name_to_first_index.end()) { ... throw ... }
-        // return m_data->items[map_it->second].first; // O(log N) or O(1) access
+        return m_data->item(position).first; // Return const reference to the T part of the pair
     }
 
     // operator[](const std::string& name) - non-const version (Requirement 4)
@@ -205,22 +631,13 @@ public:
     T& operator[](const std::string& name) {
         detach(); // Ensure unique copy before potential modification
 
-        // Find the element (similar to const version)
-        auto it = std::find_if(m_data->items.begin(), m_data->items.end(),
-                               [&name](const value_type& element) {
-                                   return element.second == name;
-                               });
-
-        if (it == m_data->items.end()) {
+        // Find the element (same index as the const version)
+        size_t position = m_data->find_first(name);
+        if (position == MyVectorData<T>::kNoPosition) {
             throw std::invalid_argument("Name not found in MyVector: " + name);
         }
-        // If using an optional name map, modification might require map update
-        // m_data->update_map_for_item(std::distance(m_data->items.begin(), it));
-        return it->first; // Return reference to the T part
-        // Optional: If using name_to_first_index map:
-        // auto map_it = m_data->name_to_first_index.find(name);
-        // if (map_it == m_data->name_to_first_index.end()) { ... throw ... }
-        // return m_data->items[map_it->second].first;
+        // Only the T part is writable through the result, so the index stays valid
+        return m_data->writable_item(position).first; // Return reference to the T part
     }
 
 
@@ -229,38 +646,46 @@ public:
     // Add an element with its name
     void push_back(const T& obj, const std::string& name) {
         detach(); // Ensure unique copy before modification
-        m_data->items.emplace_back(obj, name); // Use emplace_back for efficiency
-        // Optional: Update name map if used
-        // m_data->update_map_after_push_back(name);
+        m_data->emplace_back(obj, name); // Use emplace_back for efficiency
+        m_data->index_push_back();
     }
 
     // Add an element using a pair
      void push_back(const value_type& value) {
         detach();
-        m_data->items.push_back(value);
-        // Optional: Update name map
-        // m_data->update_map_after_push_back(value.second);
+        m_data->emplace_back(value);
+        m_data->index_push_back();
      }
 
      void push_back(value_type&& value) {
         detach();
-        m_data->items.push_back(std::move(value));
-        // Optional: Update name map
-        // m_data->update_map_after_push_back(m_data->items.back().second); 
+        m_data->emplace_back(std::move(value));
+        m_data->index_push_back();
      }
 
+    // Rename the element at index, keeping the name index up to date
+    // (renaming through operator[](size_type) works too, but leaves the
+    // element for the next name lookup to re-check)
+    void set_name(size_type index, const std::string& name) {
+        detach();
+        if (index >= m_data->count) {
+             throw std::out_of_range("Index out of range");
+        }
+        m_data->rename(index, name);
+    }
+
     // Clear all elements
     void clear() {
         detach(); // Ensure unique copy (or create new empty one if needed)
-        m_data->items.clear();
-        // Optional: Clear name map
-        // m_data->name_to_first_index.clear();
+        m_data->clear();
+        m_data->index_clear();
     }
 
     // Reserve capacity
     void reserve(size_type new_cap) {
         detach(); // Ensure unique copy before modification
-        m_data->items.reserve(new_cap);
+        m_data->reserve(new_cap);
+        m_data->index_reserve(new_cap);
     }
 
 
@@ -269,13 +694,13 @@ public:
     // Check if empty
     [[nodiscard]] bool empty() const noexcept {
         // No modification, no detach needed. Thread-safe read via shared_ptr.
-        return !m_data || m_data->items.empty();
+        return !m_data || m_data->count == 0;
     }
 
     // Get size
     size_type size() const noexcept {
         // No modification, no detach needed. Thread-safe read via shared_ptr.
-        return m_data ? m_data->items.size() : 0;
+        return m_data ? m_data->count : 0;
     }
 
 
@@ -284,15 +709,13 @@ public:
     // begin() - non-const
     iterator begin() {
         detach(); // Ensure unique copy before allowing modification via iterator
-        return iterator(m_data->items.begin());
+        return iterator(m_data.get(), 0);
     }
 
     // cbegin() - const
     const_iterator cbegin() const noexcept {
         // Const access, no detach needed
-        // Note: Returning a const_iterator based on the non-const vector iterator.
-        // A potentially better implementation might require a dedicated const vector iterator type.
-        return const_iterator(m_data ? m_data->items.cbegin() : typename std::vector<value_type>::const_iterator{});
+        return const_iterator(m_data.get(), 0);
     }
 
     // begin() - const version
@@ -303,13 +726,13 @@ public:
     // end() - non-const
     iterator end() {
         detach(); // Ensure unique copy
-        return iterator(m_data->items.end());
+        return iterator(m_data.get(), m_data->count);
     }
 
     // cend() - const
     const_iterator cend() const noexcept {
         // Const access, no detach needed
-         return const_iterator(m_data ? m_data->items.cend() : typename std::vector<value_type>::const_iterator{});
+         return const_iterator(m_data.get(), size());
     }
 
     // end() - const version
@@ -0,0 +1,92 @@
+// Benchmarks for RevisedImplementation.hpp. Name lookups are timed against
+// the linear search of the original implementation, over a plain vector of
+// the same pairs, and next to the writes that used to invalidate the index.
+// Built by the Makefile's benchmark target (with optimisation).
+#include "RevisedImplementation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double NanosecondsPer(Clock::time_point start, Clock::time_point end, size_t operations) {
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(operations);
+}
+
+static std::string ElementName(size_t i) {
+    return "element_" + std::to_string(i);
+}
+
+// Names of random elements, so the lookups do not all hit one cache line.
+static std::vector<std::string> RandomKeys(size_t n) {
+    std::mt19937 rng(1);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 1000; ++i) {
+        keys.push_back(ElementName(rng() % n));
+    }
+    return keys;
+}
+
+static void BenchLookup(size_t n) {
+    MyVector<int> v;
+    std::vector<std::pair<int, std::string>> flat;
+    v.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        v.push_back(static_cast<int>(i), ElementName(i));
+        flat.emplace_back(static_cast<int>(i), ElementName(i));
+    }
+    std::vector<std::string> keys = RandomKeys(n);
+    const MyVector<int>& cv = v;
+    long sum = 0;
+
+    const size_t lookups = 1000000;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += cv[keys[i % keys.size()]];
+    }
+    double indexed = NanosecondsPer(start, Clock::now(), lookups);
+
+    const size_t scans = std::max<size_t>(10, 20000000 / n);
+    start = Clock::now();
+    for (size_t i = 0; i < scans; ++i) {
+        const std::string& key = keys[i % keys.size()];
+        sum += std::find_if(flat.begin(), flat.end(), [&](const auto& p) { return p.second == key; })->first;
+    }
+    double linear = NanosecondsPer(start, Clock::now(), scans);
+
+    // Hot loop of element writes through operator[](size_type) and lookups
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        v[i % n].first += 1;
+        sum += cv[keys[i % keys.size()]];
+    }
+    double mixed = NanosecondsPer(start, Clock::now(), lookups);
+
+    // Renames through set_name(), each followed by a lookup of the new name
+    std::vector<std::string> renamed_keys;
+    for (const std::string& key : keys) {
+        renamed_keys.push_back(key + "_renamed");
+    }
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        size_t k = i % keys.size();
+        size_t position = static_cast<size_t>(std::stoul(keys[k].substr(8))); // "element_<position>"
+        const std::string& name = (i / keys.size()) % 2 == 0 ? renamed_keys[k] : keys[k];
+        v.set_name(position, name);
+        sum += cv[name];
+    }
+    double renamed = NanosecondsPer(start, Clock::now(), lookups);
+
+    std::printf("n=%-8zu lookup %7.1f ns  linear %12.1f ns  write+lookup %7.1f ns  set_name+lookup %7.1f ns  (%ld)\n",
+                n, indexed, linear, mixed, renamed, sum);
+}
+
+int main() {
+    for (size_t n : {1000, 10000, 100000, 1000000}) {
+        BenchLookup(n);
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Randomized tests for RevisedImplementation.hpp: every MyVector is driven
+// next to a plain std::vector of pairs holding what it should contain, and
+// name lookups are checked against a linear search of that reference.
+// Built by the Makefile's test target; exits non-zero on the first mismatch.
+#include "RevisedImplementation.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Reference = std::vector<std::pair<int, std::string>>;
+
+static int g_failures = 0;
+
+static void Fail(const char* test, int step, const std::string& detail) {
+    std::printf("FAIL %s (step %d): %s\n", test, step, detail.c_str());
+    ++g_failures;
+}
+
+// Position of the first element called name, or -1.
+static long ReferenceFind(const Reference& ref, const std::string& name) {
+    auto it = std::find_if(ref.begin(), ref.end(), [&](const auto& p) { return p.second == name; });
+    return it == ref.end() ? -1 : static_cast<long>(it - ref.begin());
+}
+
+// Position of the element v[name] refers to, or -1 if the lookup throws.
+static long VectorFind(const MyVector<int>& v, const std::string& name) {
+    try {
+        const int& found = v[name];
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (&v[i].first == &found) {
+                return static_cast<long>(i);
+            }
+        }
+        return -2; // A reference to no element at all
+    } catch (const std::invalid_argument&) {
+        return -1;
+    }
+}
+
+static std::string RandomName(std::mt19937& rng, unsigned names) {
+    return "n" + std::to_string(rng() % names);
+}
+
+// Compares the elements and the first occurrence of every possible name.
+static bool Matches(const MyVector<int>& v, const Reference& ref, unsigned names) {
+    if (v.size() != ref.size() || !std::equal(v.begin(), v.end(), ref.begin())) {
+        return false;
+    }
+    for (unsigned k = 0; k < names; ++k) {
+        std::string name = "n" + std::to_string(k);
+        if (VectorFind(v, name) != ReferenceFind(ref, name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Name lookups after every way of changing names: push_back, set_name, and
+// writes through operator[](size_type) and iterators, single and in bulk.
+static void TestNameIndex() {
+    const unsigned names = 200;
+    std::mt19937 rng(49);
+    MyVector<int> v;
+    Reference ref;
+    for (int step = 0; step < 200000; ++step) {
+        unsigned op = rng() % 100;
+        std::string name = RandomName(rng, names);
+        if (op < 35 || ref.empty()) {
+            v.push_back(step, name);
+            ref.emplace_back(step, name);
+        } else if (op < 50) {
+            size_t i = rng() % ref.size();
+            v.set_name(i, name);
+            ref[i].second = name;
+        } else if (op < 56) {
+            size_t i = rng() % ref.size();
+            v[i].second = name;
+            ref[i].second = name;
+        } else if (op < 60) {
+            size_t i = rng() % ref.size();
+            (v.begin() + i)->second = name;
+            ref[i].second = name;
+        } else if (op < 63) {
+            size_t i = rng() % ref.size();
+            v[i].first = -step; // An element-only write
+            ref[i].first = -step;
+        } else if (op < 64) {
+            // Renames more elements than are re-checked one by one
+            for (size_t i = 0; i < ref.size(); i += 3) {
+                v[i].second = RandomName(rng, names);
+                ref[i].second = v[i].second;
+            }
+        } else if (op < 65) {
+            v.reserve(ref.size() + 100);
+        } else if (op < 66 && rng() % 8 == 0) {
+            v.clear();
+            ref.clear();
+        } else {
+            long expected = ReferenceFind(ref, name);
+            long found = VectorFind(v, name);
+            if (found != expected) {
+                Fail("TestNameIndex", step, name + ": found " + std::to_string(found) + ", expected " + std::to_string(expected));
+                return;
+            }
+        }
+    }
+    if (!Matches(v, ref, names)) {
+        Fail("TestNameIndex", -1, "final contents");
+    }
+}
+
+// The same element renamed several times before a lookup, and names moved
+// between elements by std::sort, which swaps through the iterators.
+static void TestRenamesBetweenLookups() {
+    MyVector<int> v;
+    Reference ref;
+    for (int i = 0; i < 1000; ++i) {
+        std::string name = "n" + std::to_string(i % 50);
+        v.push_back((i * 7919) % 1000, name);
+        ref.emplace_back((i * 7919) % 1000, name);
+    }
+    v[10].second = "n1";
+    v[10].second = "n2";
+    v.set_name(10, "renamed");
+    v[10].second = "n3";
+    ref[10].second = "n3";
+    if (!Matches(v, ref, 60)) {
+        Fail("TestRenamesBetweenLookups", 0, "one element renamed repeatedly");
+    }
+    std::sort(v.begin(), v.end());
+    std::sort(ref.begin(), ref.end());
+    if (!Matches(v, ref, 60)) {
+        Fail("TestRenamesBetweenLookups", 1, "after std::sort");
+    }
+}
+
+// Copies share their blocks and index until one of them writes: every copy
+// must keep its contents while the original goes on with push_back,
+// set_name, element writes, std::sort through mutable iterators and clear.
+static void TestSnapshots() {
+    const unsigned names = 100;
+    std::mt19937 rng(50);
+    MyVector<int> v;
+    Reference ref;
+    std::vector<MyVector<int>> snapshots;
+    std::vector<Reference> snapshot_refs;
+    for (int step = 0; step < 50000; ++step) {
+        unsigned op = rng() % 100;
+        std::string name = RandomName(rng, names);
+        if (op < 40 || ref.empty()) {
+            v.push_back(step, name);
+            ref.emplace_back(step, name);
+        } else if (op < 55) {
+            size_t i = rng() % ref.size();
+            v.set_name(i, name);
+            ref[i].second = name;
+        } else if (op < 70) {
+            size_t i = rng() % ref.size();
+            v[i].first = -step;
+            ref[i].first = -step;
+        } else if (op < 73) {
+            // Sort a random range, swapping elements of shared blocks
+            size_t first = rng() % ref.size();
+            size_t last = first + rng() % (ref.size() - first + 1);
+            std::sort(v.begin() + first, v.begin() + last);
+            std::sort(ref.begin() + first, ref.begin() + last);
+        } else if (op < 80) {
+            snapshots.push_back(v);
+            snapshot_refs.push_back(ref);
+        } else if (op < 81 && !snapshots.empty()) {
+            // Clear a shared copy; the other copies keep the elements
+            size_t s = rng() % snapshots.size();
+            MyVector<int> copy = snapshots[s];
+            copy.clear();
+            if (!copy.empty() || !Matches(snapshots[s], snapshot_refs[s], names)) {
+                Fail("TestSnapshots", step, "clear() on a shared copy");
+                return;
+            }
+            if (rng() % 2 == 0) {
+                v.clear();
+                ref.clear();
+            }
+        } else if (op < 82 && !snapshots.empty()) {
+            size_t s = rng() % snapshots.size();
+            v = snapshots[s];
+            ref = snapshot_refs[s];
+        } else if (op < 84) {
+            long expected = ReferenceFind(ref, name);
+            if (VectorFind(v, name) != expected) {
+                Fail("TestSnapshots", step, "lookup of " + name);
+                return;
+            }
+        }
+        if (step % 1000 == 0 && !Matches(v, ref, names)) {
+            Fail("TestSnapshots", step, "contents");
+            return;
+        }
+    }
+    for (size_t s = 0; s < snapshots.size(); ++s) {
+        if (!Matches(snapshots[s], snapshot_refs[s], names)) {
+            Fail("TestSnapshots", -1, "snapshot " + std::to_string(s) + " changed");
+            return;
+        }
+    }
+}
+
+// A mutable iterator converts to a const one and compares with it.
+static void TestIteratorConversion() {
+    MyVector<int> v;
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(i, "n" + std::to_string(i));
+    }
+    MyVector<int>::const_iterator it = v.begin();
+    MyVector<int>::const_iterator end = v.end();
+    MyVector<int>::iterator last = v.end() - 1;
+    if (end - it != 100 || it == last || !(it < last) || last - it != 99 || it + 99 != last || (it + 99)->first != 99) {
+        Fail("TestIteratorConversion", 0, "mixed iterator arithmetic");
+    }
+    it = last;
+    if (it != last || it->second != "n99") {
+        Fail("TestIteratorConversion", 1, "assignment from a mutable iterator");
+    }
+}
+
+// Const lookups from several threads settle the index once between them.
+static void TestConcurrentLookups() {
+    MyVector<int> v;
+    for (int i = 0; i < 100000; ++i) {
+        v.push_back(i, "k" + std::to_string(i));
+    }
+    v[5].second = "k7"; // Element 5 now comes first for k7, and k5 is gone
+    const MyVector<int>& cv = v;
+    std::vector<std::thread> threads;
+    std::vector<int> ok(4, 1);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cv, &ok, t] {
+            for (int i = t; i < 100000; i += 4) {
+                int expected = i == 7 ? 5 : i;
+                try {
+                    int found = cv["k" + std::to_string(i)];
+                    ok[t] &= i != 5 && found == expected;
+                } catch (const std::invalid_argument&) {
+                    ok[t] &= i == 5;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (std::count(ok.begin(), ok.end(), 1) != 4) {
+        Fail("TestConcurrentLookups", 0, "wrong lookup result");
+    }
+}
+
+int main() {
+    TestNameIndex();
+    TestRenamesBetweenLookups();
+    TestSnapshots();
+    TestIteratorConversion();
+    TestConcurrentLookups();
+    if (g_failures == 0) {
+        std::printf("All tests passed\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+// Per-connection byte buffers backed by a pool of fixed-size blocks.
+//
+// A pooled buffer holds a block only while it has data, so idle connections
+// cost no buffer memory, and blocks move from connection to connection
+// instead of going back to the heap: once the pool is warm, receiving and
+// replying do not allocate. Pools are not thread-safe; each event loop owns one.
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+constexpr size_t POOL_BLOCK_SIZE = 16 * 1024;
+
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_free = 4096) : max_free_(max_free) {
+        free_.reserve(max_free); // release() must not allocate either
+    }
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    ~BufferPool() {
+        for (char* block : free_) {
+            delete[] block;
+        }
+    }
+
+    char* acquire() {
+        if (free_.empty()) {
+            return new char[POOL_BLOCK_SIZE];
+        }
+        char* block = free_.back();
+        free_.pop_back();
+        return block;
+    }
+
+    void release(char* block) {
+        if (free_.size() < max_free_) {
+            free_.push_back(block);
+        } else {
+            delete[] block; // Keep at most max_free idle blocks
+        }
+    }
+
+private:
+    std::vector<char*> free_;
+    size_t max_free_;
+};
+
+// A contiguous byte queue: bytes are added at the back and consumed from the
+// front. Storage is a pool block while the contents fit in one, and a heap
+// block (grown by doubling) for oversized messages or backlogs. Without a
+// pool the buffer simply keeps whatever storage it has grown to.
+class ByteBuffer {
+public:
+    explicit ByteBuffer(BufferPool* pool = nullptr) : pool_(pool) {}
+    ByteBuffer(const ByteBuffer&) = delete;
+    ByteBuffer& operator=(const ByteBuffer&) = delete;
+    ~ByteBuffer() { free_storage(); }
+
+    bool empty() const { return begin_ == end_; }
+    size_t size() const { return end_ - begin_; }
+    const char* data() const { return storage_ + begin_; }
+
+    // Returns room for at least n more bytes, moving or regrowing the contents if needed.
+    char* prepare(size_t n) {
+        if (capacity_ - end_ < n) {
+            size_t used = size();
+            if (storage_ != nullptr && used + n <= capacity_) {
+                memmove(storage_, storage_ + begin_, used);
+            } else {
+                regrow(used + n);
+            }
+            begin_ = 0;
+            end_ = used;
+        }
+        return storage_ + end_;
+    }
+
+    // Bytes that can be written at prepare()'s pointer; at least the n asked for.
+    size_t room() const { return capacity_ - end_; }
+
+    // Marks n bytes written at prepare()'s pointer as contents.
+    void commit(size_t n) { end_ += n; }
+
+    void append(const char* bytes, size_t n) {
+        memcpy(prepare(n), bytes, n);
+        commit(n);
+    }
+
+    void consume(size_t n) {
+        begin_ += n;
+        if (begin_ == end_) {
+            begin_ = end_ = 0;
+            if (pool_ != nullptr) {
+                free_storage(); // Empty: hand the block back until data arrives again
+            }
+        }
+    }
+
+    // Hands an empty buffer's pool block back. Buffers normally do so on
+    // consume(); this covers storage that is prepared but never filled.
+    void trim() {
+        if (empty() && pooled_) {
+            begin_ = end_ = 0;
+            free_storage();
+        }
+    }
+
+private:
+    void regrow(size_t needed) {
+        char* storage;
+        size_t capacity;
+        bool pooled = pool_ != nullptr && needed <= POOL_BLOCK_SIZE;
+        if (pooled) {
+            storage = pool_->acquire();
+            capacity = POOL_BLOCK_SIZE;
+        } else {
+            capacity = capacity_ > POOL_BLOCK_SIZE ? capacity_ : POOL_BLOCK_SIZE;
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+            storage = new char[capacity];
+        }
+        if (storage_ != nullptr) {
+            memcpy(storage, storage_ + begin_, size());
+        }
+        free_storage();
+        storage_ = storage;
+        capacity_ = capacity;
+        pooled_ = pooled;
+    }
+
+    void free_storage() {
+        if (storage_ == nullptr) {
+            return;
+        }
+        if (pooled_) {
+            pool_->release(storage_);
+        } else {
+            delete[] storage_;
+        }
+        storage_ = nullptr;
+        capacity_ = 0;
+        pooled_ = false;
+    }
+
+    BufferPool* pool_;
+    char* storage_ = nullptr;
+    size_t capacity_ = 0;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+    bool pooled_ = false; // storage_ came from pool_
+};
+
+#endif
@@ -8,10 +8,28 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+#include <poll.h>
+
+#include "framing.hpp"
+#include "shm_ring.hpp"
+#include "LatencyHistogram.hpp" // From "HW ~ Multithreading" (see the Makefile)
 
 constexpr const char* SERVER_IP = "127.0.0.1"; // Localhost
 constexpr int SERVER_PORT = 8080;
 constexpr int BUFFER_SIZE = 1024;
+constexpr int POLL_TIMEOUT_MS = 200; // How often a shared-memory receiver checks g_connected
 
 // Flag to control the receiver thread loop
 std::atomic<bool> g_connected = true;
@@ -19,9 +37,10 @@ std::atomic<bool> g_connected = true;
 // Function to receive messages from the server
 void receive_messages(int client_socket) {
     char buffer[BUFFER_SIZE];
+    LineFramer framer;
+    std::string response;
     while (g_connected) {
-        memset(buffer, 0, BUFFER_SIZE);
-        ssize_t bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        ssize_t bytes_received = recv(client_socket, buffer, BUFFER_SIZE, 0);
 
         if (!g_connected) break; // Check flag again in case disconnect happened while blocked
 
@@ -40,14 +59,683 @@ void receive_messages(int client_socket) {
              // close(client_socket); // Could cause issues if main thread tries to send after this
             break;
         }
-        buffer[bytes_received] = '\0'; // Null-terminate
-        std::cout << "\nServer response: " << buffer; // Print response (server should add \n)
-        std::cout << "Enter message ('disconnect' to quit): " << std::flush; // Re-prompt user
+        // Replies are newline-framed: a read may hold several of them, or part of one
+        framer.append(buffer, static_cast<size_t>(bytes_received));
+        bool printed = false;
+        while (framer.next(response)) {
+            std::cout << "\nServer response: " << response;
+            printed = true;
+        }
+        if (printed) {
+            std::cout << "\nEnter message ('disconnect' to quit): " << std::flush; // Re-prompt user
+        }
     }
      std::cout << "Receiver thread finished." << std::endl;
 }
 
-int main() {
+// The same for a shared-memory link: drains the reply ring, sleeping on the
+// link's eventfd while it is empty.
+void receive_shm_messages(ShmLink* link) {
+    char buffer[BUFFER_SIZE];
+    LineFramer framer;
+    std::string response;
+    while (g_connected) {
+        size_t received = link->receive(buffer, sizeof(buffer));
+        if (received == 0) {
+            if (link->broken()) {
+                std::cerr << "\nShared region corrupted." << std::endl;
+                g_connected = false;
+                break;
+            }
+            if (!link->want_readable()) {
+                continue; // A reply arrived meanwhile
+            }
+            struct pollfd fds[2] = {{link->event_fd(), POLLIN, 0}, {link->socket_fd(), POLLRDHUP, 0}};
+            int ready = poll(fds, 2, POLL_TIMEOUT_MS);
+            if (ready > 0 && fds[1].revents != 0) {
+                std::cout << "\nServer disconnected." << std::endl;
+                g_connected = false;
+                break;
+            }
+            link->clear_wakeups();
+            continue;
+        }
+        framer.append(buffer, received);
+        bool printed = false;
+        while (framer.next(response)) {
+            std::cout << "\nServer response: " << response;
+            printed = true;
+        }
+        if (printed) {
+            std::cout << "\nEnter message ('disconnect' to quit): " << std::flush; // Re-prompt user
+        }
+    }
+    std::cout << "Receiver thread finished." << std::endl;
+}
+
+// Sends all of data through a shared-memory link. The receiver thread owns
+// the link's eventfd, so a full ring is waited out by polling.
+bool shm_send_all(ShmLink& link, const char* data, size_t size) {
+    while (size > 0) {
+        size_t sent = link.send(data, size);
+        if (link.broken()) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+        if (size > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return true;
+}
+
+// Connects a blocking Unix stream socket to path. Returns -1 (with errno set) on failure.
+int connect_unix(const std::string& path) {
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// --- Load generator (--bench) ---
+//
+// Opens many connections spread over a few threads, each thread driving its
+// connections from one epoll loop with non-blocking sockets. Two ways to load
+// the server:
+//   * open loop (--rate R): R messages/s in total are scheduled at fixed
+//     intervals no matter how fast replies come back. Latency is measured
+//     from the *scheduled* send time, so a stalled server is charged for the
+//     requests it delayed (no coordinated omission);
+//   * closed loop (default): every connection keeps --pipeline D requests
+//     outstanding and sends a new one as each reply arrives.
+// Replies are matched to requests in order: the server answers every
+// message of n bytes with n + 1 bytes ("hello" becomes "world").
+//
+// The load goes over TCP, a Unix socket (--unix PATH) or a shared-memory
+// link (--shm PATH); --compare runs the same load over TCP and then over
+// each of the others given, and sums up their latencies side by side.
+
+constexpr int BENCH_MAX_EVENTS = 256;
+constexpr double BENCH_DRAIN_SECONDS = 5.0; // How long to wait for replies to measured requests after the run
+
+// Message sizes: "N" (fixed), "MIN-MAX" (uniform) or "A,B,C" (one of the values, equally likely).
+struct SizeDistribution {
+    std::vector<size_t> choices; // Used when non-empty
+    size_t min = 64;
+    size_t max = 64;
+
+    bool parse(const std::string& spec) {
+        try {
+            size_t dash = spec.find('-');
+            if (spec.find(',') != std::string::npos) {
+                size_t begin = 0;
+                while (begin <= spec.size()) {
+                    size_t comma = spec.find(',', begin);
+                    if (comma == std::string::npos) {
+                        comma = spec.size();
+                    }
+                    choices.push_back(std::stoul(spec.substr(begin, comma - begin)));
+                    begin = comma + 1;
+                }
+                min = *std::min_element(choices.begin(), choices.end());
+                max = *std::max_element(choices.begin(), choices.end());
+            } else if (dash != std::string::npos) {
+                min = std::stoul(spec.substr(0, dash));
+                max = std::stoul(spec.substr(dash + 1));
+            } else {
+                min = max = std::stoul(spec);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        return min <= max && max < MAX_MESSAGE_SIZE;
+    }
+
+    size_t sample(std::mt19937_64& rng) const {
+        if (!choices.empty()) {
+            return choices[rng() % choices.size()];
+        }
+        return min == max ? min : min + rng() % (max - min + 1);
+    }
+};
+
+struct BenchConfig {
+    std::string host = SERVER_IP;
+    int port = SERVER_PORT;
+    int connections = 16;
+    int threads = 1;
+    double duration = 5.0; // Measured seconds
+    double warmup = 1.0;   // Seconds before measuring starts
+    double rate = 0.0;     // Messages per second in total; 0 = closed loop
+    int pipeline = 1;      // Outstanding requests per connection in closed loop
+    SizeDistribution sizes;
+    std::string unix_path; // Connect to this Unix socket instead of host:port
+    std::string shm_path;  // Talk through shared memory, set up over this Unix socket
+    bool compare = false;  // Run over every transport given and compare
+};
+
+struct BenchConnection {
+    int fd = -1;            // The socket, or the shared-memory link's eventfd
+    std::unique_ptr<ShmLink> shm;
+    std::string output;     // Requests not yet accepted by the kernel
+    size_t output_sent = 0;
+    bool want_write = false;
+    // Requests awaiting their reply, oldest first: (send time in ns, reply length).
+    std::deque<std::pair<uint64_t, size_t>> inflight;
+    size_t reply_received = 0; // Bytes already received of the oldest reply
+};
+
+struct BenchResult {
+    LatencyHistogram latency; // Nanoseconds, measured requests only
+    uint64_t sent = 0;        // Measured requests sent
+    uint64_t completed = 0;   // Measured requests answered
+    uint64_t bytes = 0;       // Request plus reply bytes of measured requests
+    uint64_t errors = 0;      // Connections lost
+};
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// The transport a benchmark run uses, for the reports.
+std::string transport_name(const BenchConfig& config) {
+    if (!config.shm_path.empty()) {
+        return "shm " + config.shm_path;
+    }
+    if (!config.unix_path.empty()) {
+        return "unix " + config.unix_path;
+    }
+    return "tcp " + config.host + ":" + std::to_string(config.port);
+}
+
+// Opens one connection over the configured transport. Sockets connect
+// blocking, then switch to non-blocking. Returns false with error set on failure.
+bool bench_connect(const BenchConfig& config, BenchConnection& conn, std::string& error) {
+    if (!config.shm_path.empty()) {
+        conn.shm = std::make_unique<ShmLink>();
+        if (!conn.shm->connect(config.shm_path, error)) {
+            return false;
+        }
+        conn.fd = conn.shm->event_fd();
+        return true;
+    }
+    int fd = -1;
+    if (!config.unix_path.empty()) {
+        fd = connect_unix(config.unix_path);
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(static_cast<uint16_t>(config.port));
+        if (fd >= 0 && (inet_pton(AF_INET, config.host.c_str(), &server_addr.sin_addr) <= 0 ||
+                        connect(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0)) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Latency, not Nagle batching
+        }
+    }
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    conn.fd = fd;
+    return true;
+}
+
+// Closes a connection of either kind.
+void bench_disconnect(BenchConnection& conn) {
+    if (conn.shm) {
+        conn.shm->reset(); // Closes the eventfd in conn.fd too
+    } else {
+        close(conn.fd);
+    }
+    conn.fd = -1;
+}
+
+using BenchConnections = std::vector<std::unique_ptr<BenchConnection>>;
+
+class BenchWorker {
+public:
+    BenchWorker(const BenchConfig& config, BenchConnections conns, int index, uint64_t start_ns, BenchResult& result) :
+        config_(config), index_(index), result_(result), rng_(0x9e3779b97f4a7c15ULL * (index + 1)),
+        conns_(std::move(conns))
+    {
+        measure_from_ = start_ns + static_cast<uint64_t>(config.warmup * 1e9);
+        measure_until_ = measure_from_ + static_cast<uint64_t>(config.duration * 1e9);
+        start_ns_ = start_ns;
+        payload_.assign(config.sizes.max, 'x');
+        live_ = conns_.size();
+    }
+
+    void run() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        for (auto& conn : conns_) {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = conn.get();
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn->fd, &ev);
+            if (conn->shm) {
+                // The link's socket only tells that the server went away.
+                ev.events = EPOLLRDHUP;
+                epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn->shm->socket_fd(), &ev);
+                on_readable(*conn); // Asks to be woken by the first reply
+            }
+        }
+
+        bool open_loop = config_.rate > 0.0;
+        uint64_t interval = 0;
+        uint64_t next_due = start_ns_;
+        if (open_loop) {
+            // This thread's share of the rate, offset so threads do not send in lockstep.
+            double per_thread = config_.rate / config_.threads;
+            interval = static_cast<uint64_t>(1e9 / per_thread);
+            next_due = start_ns_ + interval * static_cast<uint64_t>(index_) / static_cast<uint64_t>(config_.threads);
+        } else {
+            for (auto& conn : conns_) {
+                for (int i = 0; i < config_.pipeline; ++i) {
+                    enqueue(*conn, now_ns());
+                }
+                flush(*conn);
+            }
+        }
+
+        uint64_t drain_until = measure_until_ + static_cast<uint64_t>(BENCH_DRAIN_SECONDS * 1e9);
+        size_t next_conn = 0;
+        struct epoll_event events[BENCH_MAX_EVENTS];
+        while (true) {
+            uint64_t now = now_ns();
+            if (now >= measure_until_ && (outstanding_measured_ == 0 || now >= drain_until || live_ == 0)) {
+                break;
+            }
+
+            if (open_loop && now < measure_until_) {
+                // Send everything that is due, stamped with when it *should* have gone out.
+                while (next_due <= now && next_due < measure_until_ && live_ > 0) {
+                    BenchConnection& conn = *conns_[next_conn++ % conns_.size()];
+                    if (conn.fd >= 0) {
+                        enqueue(conn, next_due);
+                        flush(conn);
+                    }
+                    next_due += interval;
+                }
+            }
+
+            // Sleep until the next send is due (open loop) or for a while (closed loop).
+            uint64_t wake = open_loop && next_due < measure_until_ ? next_due : now + 10000000;
+            if (wake > drain_until) {
+                wake = drain_until;
+            }
+            uint64_t wait = wake > now ? wake - now : 0;
+            struct timespec timeout;
+            timeout.tv_sec = static_cast<time_t>(wait / 1000000000);
+            timeout.tv_nsec = static_cast<long>(wait % 1000000000);
+            int count = epoll_pwait2(epoll_fd_, events, BENCH_MAX_EVENTS, &timeout, nullptr);
+            if (count < 0 && errno != EINTR) {
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                auto* conn = static_cast<BenchConnection*>(events[i].data.ptr);
+                if (conn->fd < 0) {
+                    continue;
+                }
+                if ((events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) || !on_readable(*conn) ||
+                    !flush(*conn)) {
+                    drop(*conn);
+                }
+            }
+        }
+
+        for (auto& conn : conns_) {
+            if (conn->fd >= 0) {
+                bench_disconnect(*conn);
+            }
+        }
+        close(epoll_fd_);
+    }
+
+private:
+    bool measured(uint64_t sent_at) const {
+        return sent_at >= measure_from_ && sent_at < measure_until_;
+    }
+
+    void enqueue(BenchConnection& conn, uint64_t sent_at) {
+        size_t size = config_.sizes.sample(rng_);
+        conn.output.append(payload_, 0, size);
+        conn.output += '\n';
+        conn.inflight.emplace_back(sent_at, size + 1); // The echo adds the newline back
+        if (measured(sent_at)) {
+            ++result_.sent;
+            ++outstanding_measured_;
+        }
+    }
+
+    // Sends queued requests; watches for writability while some remain.
+    bool flush(BenchConnection& conn) {
+        if (conn.shm) {
+            return flush_shm(conn);
+        }
+        while (conn.output_sent < conn.output.size()) {
+            ssize_t sent = send(conn.fd, conn.output.data() + conn.output_sent,
+                                conn.output.size() - conn.output_sent, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                return false;
+            }
+            conn.output_sent += static_cast<size_t>(sent);
+        }
+        bool pending = conn.output_sent < conn.output.size();
+        if (!pending) {
+            conn.output.clear();
+            conn.output_sent = 0;
+        }
+        if (pending != conn.want_write) {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN | (pending ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            ev.data.ptr = &conn;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.want_write = pending;
+        }
+        return true;
+    }
+
+    // The same through a shared-memory link: a full ring asks the server to
+    // wake the connection's eventfd once it has taken something out.
+    bool flush_shm(BenchConnection& conn) {
+        while (conn.output_sent < conn.output.size()) {
+            conn.output_sent += conn.shm->send(conn.output.data() + conn.output_sent,
+                                               conn.output.size() - conn.output_sent);
+            if (conn.output_sent < conn.output.size() && conn.shm->want_writable()) {
+                break;
+            }
+        }
+        if (conn.output_sent == conn.output.size()) {
+            conn.output.clear();
+            conn.output_sent = 0;
+        }
+        return !conn.shm->broken();
+    }
+
+    // Consumes reply bytes, completing requests in order. Returns false if the connection is gone.
+    bool on_readable(BenchConnection& conn) {
+        char buffer[BUFFER_SIZE];
+        if (conn.shm) {
+            conn.shm->clear_wakeups();
+            while (true) {
+                size_t received = conn.shm->receive(buffer, sizeof(buffer));
+                if (received > 0) {
+                    consume(conn, received);
+                } else if (conn.shm->broken()) {
+                    return false;
+                } else if (conn.shm->want_readable()) {
+                    return true; // The server wakes us with the next reply
+                }
+            }
+        }
+        while (true) {
+            ssize_t received = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if (received == 0) {
+                return false;
+            }
+            consume(conn, static_cast<size_t>(received));
+        }
+    }
+
+    // Counts size reply bytes against the oldest outstanding requests.
+    void consume(BenchConnection& conn, size_t size) {
+        uint64_t now = now_ns();
+        while (size > 0 && !conn.inflight.empty()) {
+            auto& front = conn.inflight.front();
+            size_t take = std::min(size, front.second - conn.reply_received);
+            conn.reply_received += take;
+            size -= take;
+            if (conn.reply_received == front.second) {
+                complete(conn, front.first, front.second, now);
+            }
+        }
+    }
+
+    void complete(BenchConnection& conn, uint64_t sent_at, size_t reply_size, uint64_t now) {
+        if (measured(sent_at)) {
+            result_.latency.Record(now - sent_at);
+            ++result_.completed;
+            result_.bytes += 2 * reply_size;
+            --outstanding_measured_;
+        }
+        conn.inflight.pop_front();
+        conn.reply_received = 0;
+        if (config_.rate <= 0.0 && now < measure_until_) {
+            enqueue(conn, now); // Closed loop: replace the answered request
+        }
+    }
+
+    void drop(BenchConnection& conn) {
+        for (const auto& request : conn.inflight) {
+            if (measured(request.first)) {
+                --outstanding_measured_;
+            }
+        }
+        conn.inflight.clear();
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+        bench_disconnect(conn);
+        ++result_.errors;
+        --live_;
+    }
+
+    const BenchConfig& config_;
+    int index_;
+    BenchResult& result_;
+    std::mt19937_64 rng_;
+    BenchConnections conns_;
+    std::string payload_;
+    size_t live_ = 0;
+    int epoll_fd_ = -1;
+    uint64_t start_ns_ = 0;
+    uint64_t measure_from_ = 0;
+    uint64_t measure_until_ = 0;
+    uint64_t outstanding_measured_ = 0;
+};
+
+bool parse_bench_args(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--compare") {
+            config.compare = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--host") {
+                config.host = value;
+            } else if (arg == "--port") {
+                config.port = std::stoi(value);
+            } else if (arg == "--connections") {
+                config.connections = std::stoi(value);
+            } else if (arg == "--threads") {
+                config.threads = std::stoi(value);
+            } else if (arg == "--duration") {
+                config.duration = std::stod(value);
+            } else if (arg == "--warmup") {
+                config.warmup = std::stod(value);
+            } else if (arg == "--rate") {
+                config.rate = std::stod(value);
+            } else if (arg == "--pipeline") {
+                config.pipeline = std::stoi(value);
+            } else if (arg == "--unix") {
+                config.unix_path = value;
+            } else if (arg == "--shm") {
+                config.shm_path = value;
+            } else if (arg == "--size") {
+                config.sizes = SizeDistribution();
+                if (!config.sizes.parse(value)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return config.connections > 0 && config.threads > 0 && config.duration > 0.0 && config.warmup >= 0.0 &&
+           config.rate >= 0.0 && config.pipeline > 0 && (config.unix_path.empty() || config.shm_path.empty() ||
+                                                         config.compare);
+}
+
+// Runs the configured load once, prints its report and leaves the totals in total.
+int run_bench_once(const BenchConfig& config, BenchResult& total) {
+    int threads = std::min(config.threads, config.connections);
+
+    // Connect everything before the clock starts.
+    std::vector<BenchConnections> conns(static_cast<size_t>(threads));
+    for (int i = 0; i < config.connections; ++i) {
+        auto conn = std::make_unique<BenchConnection>();
+        std::string error;
+        if (!bench_connect(config, *conn, error)) {
+            std::cerr << "Connection " << i << " over " << transport_name(config) << " failed: " << error
+                      << std::endl;
+            for (auto& group : conns) {
+                for (auto& open : group) {
+                    bench_disconnect(*open);
+                }
+            }
+            return 1;
+        }
+        conns[static_cast<size_t>(i % threads)].push_back(std::move(conn));
+    }
+
+    std::cout << "Benchmarking " << transport_name(config) << " with " << config.connections
+              << " connection(s) on " << threads << " thread(s), "
+              << (config.rate > 0.0 ? "open loop at " + std::to_string(static_cast<long long>(config.rate)) + " msg/s"
+                                    : "closed loop, pipeline depth " + std::to_string(config.pipeline))
+              << ", " << config.warmup << "s warmup + " << config.duration << "s measured..." << std::endl;
+
+    BenchConfig effective = config;
+    effective.threads = threads;
+    uint64_t start = now_ns();
+    std::vector<BenchResult> results(static_cast<size_t>(threads));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            BenchWorker worker(effective, std::move(conns[static_cast<size_t>(t)]), t, start,
+                               results[static_cast<size_t>(t)]);
+            worker.run();
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const BenchResult& result : results) {
+        total.latency.Merge(result.latency);
+        total.sent += result.sent;
+        total.completed += result.completed;
+        total.bytes += result.bytes;
+        total.errors += result.errors;
+    }
+
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1)
+              << "Throughput: " << static_cast<double>(total.completed) / config.duration << " msg/s, "
+              << static_cast<double>(total.bytes) / config.duration / (1024.0 * 1024.0) << " MiB/s\n"
+              << "Latency (us): p50 " << us(total.latency.Percentile(50.0))
+              << "  p90 " << us(total.latency.Percentile(90.0))
+              << "  p99 " << us(total.latency.Percentile(99.0))
+              << "  p99.9 " << us(total.latency.Percentile(99.9))
+              << "  max " << us(total.latency.Max())
+              << "  mean " << us(static_cast<uint64_t>(total.latency.Mean())) << "\n"
+              << "Requests: " << total.sent << " sent, " << total.completed << " answered, "
+              << (total.sent - total.completed) << " unanswered, " << total.errors << " connection(s) lost"
+              << std::endl;
+    return total.errors == 0 && total.completed == total.sent ? 0 : 1;
+}
+
+int run_bench(const BenchConfig& config) {
+    if (!config.compare) {
+        BenchResult total;
+        return run_bench_once(config, total);
+    }
+
+    // The same load over TCP, then over each local transport given.
+    std::vector<BenchConfig> runs;
+    BenchConfig tcp = config;
+    tcp.unix_path.clear();
+    tcp.shm_path.clear();
+    runs.push_back(tcp);
+    if (!config.unix_path.empty()) {
+        runs.push_back(tcp);
+        runs.back().unix_path = config.unix_path;
+    }
+    if (!config.shm_path.empty()) {
+        runs.push_back(tcp);
+        runs.back().shm_path = config.shm_path;
+    }
+    std::vector<BenchResult> totals(runs.size());
+    int status = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        status |= run_bench_once(runs[i], totals[i]);
+    }
+
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::cout << "\nRound-trip latency (us):\n" << std::left << std::setw(28) << "transport" << std::right
+              << std::setw(12) << "msg/s" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10)
+              << "p99.9" << std::setw(10) << "mean" << "\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const BenchResult& total = totals[i];
+        std::cout << std::left << std::setw(28) << transport_name(runs[i]) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << static_cast<double>(total.completed) / config.duration
+                  << std::setw(10) << us(total.latency.Percentile(50.0)) << std::setw(10)
+                  << us(total.latency.Percentile(99.0)) << std::setw(10) << us(total.latency.Percentile(99.9))
+                  << std::setw(10) << us(static_cast<uint64_t>(total.latency.Mean())) << "\n";
+    }
+    std::cout << std::flush;
+    return status;
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--unix PATH | --shm PATH]   interactive session\n"
+              << "       " << program << " --bench [--host IP] [--port N] [--connections N] [--threads N]\n"
+              << "                [--duration S] [--warmup S] [--rate MSG_PER_S | --pipeline DEPTH]\n"
+              << "                [--size N | MIN-MAX | A,B,C] [--unix PATH | --shm PATH] [--compare]" << std::endl;
+}
+
+// Connects the interactive session to SERVER_IP:SERVER_PORT. Returns -1 on failure.
+int connect_tcp() {
     int client_fd;
     struct sockaddr_in server_addr;
 
@@ -55,7 +743,7 @@ int main() {
     client_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (client_fd < 0) {
         std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
-        return 1;
+        return -1;
     }
 
     // 2. Prepare server address structure
@@ -67,20 +755,66 @@ int main() {
     if (inet_pton(AF_INET, SERVER_IP, &server_addr.sin_addr) <= 0) {
         std::cerr << "Invalid address/ Address not supported: " << SERVER_IP << std::endl;
         close(client_fd);
-        return 1;
+        return -1;
     }
 
     // 3. Connect to the server
     if (connect(client_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         std::cerr << "Connection Failed: " << strerror(errno) << std::endl;
         close(client_fd);
-        return 1;
+        return -1;
     }
 
     std::cout << "Connected to server " << SERVER_IP << ":" << SERVER_PORT << std::endl;
+    return client_fd;
+}
+
+int main(int argc, char* argv[]) {
+    std::string unix_path;
+    std::string shm_path;
+    if (argc > 1) {
+        std::string mode = argv[1];
+        if (argc == 3 && mode == "--unix") {
+            unix_path = argv[2];
+        } else if (argc == 3 && mode == "--shm") {
+            shm_path = argv[2];
+        } else {
+            BenchConfig config;
+            if (mode != "--bench" || !parse_bench_args(argc, argv, config)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            return run_bench(config);
+        }
+    }
+
+    int client_fd = -1;
+    std::unique_ptr<ShmLink> link;
+    if (!shm_path.empty()) {
+        link = std::make_unique<ShmLink>();
+        std::string error;
+        if (!link->connect(shm_path, error)) {
+            std::cerr << "Connection Failed: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Connected to server through shared memory (" << shm_path << ")" << std::endl;
+    } else if (!unix_path.empty()) {
+        client_fd = connect_unix(unix_path);
+        if (client_fd < 0) {
+            std::cerr << "Connection Failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        std::cout << "Connected to server " << unix_path << std::endl;
+    } else {
+        client_fd = connect_tcp();
+        if (client_fd < 0) {
+            return 1;
+        }
+    }
 
     // 4. Start receiver thread
-    std::thread receiver_thread(receive_messages, client_fd);
+    std::thread receiver_thread = link ? std::thread(receive_shm_messages, link.get())
+                                       : std::thread(receive_messages, client_fd);
 
     // 5. Main loop to send messages
     std::string input_line;
@@ -100,18 +834,17 @@ int main() {
             break;
         }
 
-        // Add newline because server might expect line-based messages
+        // The newline ends the message (see framing.hpp)
         input_line += "\n";
 
-        // Send message to server
-        ssize_t bytes_sent = send(client_fd, input_line.c_str(), input_line.length(), 0);
-        if (bytes_sent < 0) {
+        // Send message to server. The receiver thread prints replies as they
+        // arrive, so lines pasted in bulk are pipelined without waiting.
+        bool sent = link ? shm_send_all(*link, input_line.c_str(), input_line.length())
+                         : send_all(client_fd, input_line.c_str(), input_line.length());
+        if (!sent) {
              std::cerr << "Error sending message: " << strerror(errno) << std::endl;
              g_connected = false; // Signal receiver thread
              break;
-        } else if (static_cast<size_t>(bytes_sent) != input_line.length()) {
-             std::cerr << "Warning: Partial send occurred." << std::endl;
-             // Handle partial send if necessary
         }
     }
 
@@ -122,7 +855,8 @@ int main() {
     // Shutdown the connection gracefully (optional but good practice)
     // SHUT_WR: Stop sending, allow receiving pending data
     // SHUT_RDWR: Stop both sending and receiving
-    if (shutdown(client_fd, SHUT_WR) < 0) {
+    // (A shared-memory receiver just notices g_connected.)
+    if (client_fd >= 0 && shutdown(client_fd, SHUT_WR) < 0) {
         if (errno != ENOTCONN) { // Ignore error if socket already disconnected
              std::cerr << "Error shutting down socket: " << strerror(errno) << std::endl;
         }
@@ -134,8 +868,12 @@ int main() {
         receiver_thread.join();
     }
 
-    // Close the socket file descriptor
-    close(client_fd);
+    // Close the socket file descriptor, or unmap the shared region
+    if (link) {
+        link->reset();
+    } else {
+        close(client_fd);
+    }
 
     std::cout << "Connection closed." << std::endl;
     return 0;
@@ -0,0 +1,209 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+// Named commands understood by the server, on top of "hello" and echo.
+//
+// A message "name argument" whose name is in the table runs that command
+// instead of being echoed. Each command says where it runs: Inline commands
+// are cheap enough for the reactor thread, Offload commands are expensive
+// and go to the compute pool so that they never stall other connections' I/O.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "stats.hpp"
+
+// --- SHA-256 (FIPS 180-4) ---
+
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset() {
+        static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(state_, initial, sizeof(state_));
+        length_ = 0;
+        used_ = 0;
+    }
+
+    void update(const void* data, size_t size) {
+        auto* bytes = static_cast<const unsigned char*>(data);
+        length_ += size;
+        while (size > 0) {
+            size_t n = std::min(size, sizeof(block_) - used_);
+            memcpy(block_ + used_, bytes, n);
+            used_ += n;
+            bytes += n;
+            size -= n;
+            if (used_ == sizeof(block_)) {
+                compress();
+                used_ = 0;
+            }
+        }
+    }
+
+    void finish(unsigned char digest[32]) {
+        uint64_t bits = length_ * 8;
+        unsigned char pad = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (used_ != 56) {
+            update(&pad, 1);
+        }
+        for (int i = 7; i >= 0; --i) {
+            unsigned char b = static_cast<unsigned char>(bits >> (i * 8));
+            update(&b, 1);
+        }
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = static_cast<unsigned char>(state_[i] >> 24);
+            digest[i * 4 + 1] = static_cast<unsigned char>(state_[i] >> 16);
+            digest[i * 4 + 2] = static_cast<unsigned char>(state_[i] >> 8);
+            digest[i * 4 + 3] = static_cast<unsigned char>(state_[i]);
+        }
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress() {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t{block_[i * 4]} << 24) | (uint32_t{block_[i * 4 + 1]} << 16) |
+                   (uint32_t{block_[i * 4 + 2]} << 8) | uint32_t{block_[i * 4 + 3]};
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+        state_[4] += e;
+        state_[5] += f;
+        state_[6] += g;
+        state_[7] += h;
+    }
+
+    uint32_t state_[8];
+    unsigned char block_[64];
+    uint64_t length_; // Bytes hashed so far
+    size_t used_;     // Bytes waiting in block_
+};
+
+inline void append_hex(std::string& out, const unsigned char* bytes, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; ++i) {
+        out += digits[bytes[i] >> 4];
+        out += digits[bytes[i] & 0xf];
+    }
+}
+
+// --- Commands ---
+
+enum class HandlerKind : uint8_t {
+    Inline, // Runs on the reactor thread, like hello and echo
+    Offload // Runs on the compute pool; its reply is posted back to the reactor
+};
+
+constexpr unsigned long MAX_HASH_ROUNDS = 1000000; // Caps the work one sha256x request can ask for
+
+struct Command {
+    std::string_view name;
+    HandlerKind kind;
+    void (*run)(std::string_view argument, std::string& reply); // Appends the reply, without a newline
+};
+
+// "size TEXT": the length of TEXT in bytes.
+inline void run_size(std::string_view argument, std::string& reply) {
+    reply += std::to_string(argument.size());
+}
+
+// "sha256 TEXT": the hex SHA-256 digest of TEXT.
+inline void run_sha256(std::string_view argument, std::string& reply) {
+    Sha256 hash;
+    unsigned char digest[32];
+    hash.update(argument.data(), argument.size());
+    hash.finish(digest);
+    append_hex(reply, digest, sizeof(digest));
+}
+
+// "sha256x ROUNDS TEXT": SHA-256 applied ROUNDS times (key stretching), in hex.
+inline void run_sha256x(std::string_view argument, std::string& reply) {
+    size_t space = argument.find(' ');
+    std::string count(argument.substr(0, space));
+    char* end = nullptr;
+    unsigned long rounds = std::strtoul(count.c_str(), &end, 10);
+    if (space == std::string_view::npos || end == count.c_str() || *end != '\0' || rounds == 0 ||
+        rounds > MAX_HASH_ROUNDS) {
+        reply += "error: usage sha256x ROUNDS TEXT (1 <= ROUNDS <= " + std::to_string(MAX_HASH_ROUNDS) + ")";
+        return;
+    }
+    Sha256 hash;
+    unsigned char digest[32];
+    hash.update(argument.data() + space + 1, argument.size() - space - 1);
+    hash.finish(digest);
+    for (unsigned long i = 1; i < rounds; ++i) {
+        hash.reset();
+        hash.update(digest, sizeof(digest));
+        hash.finish(digest);
+    }
+    append_hex(reply, digest, sizeof(digest));
+}
+
+// "stats": one line of live server statistics (see stats.hpp).
+inline void run_stats(std::string_view, std::string& reply) {
+    ServerStats::instance().report(reply);
+}
+
+inline const Command COMMANDS[] = {
+    {"size", HandlerKind::Inline, run_size},
+    {"stats", HandlerKind::Inline, run_stats},
+    {"sha256", HandlerKind::Offload, run_sha256},
+    {"sha256x", HandlerKind::Offload, run_sha256x},
+};
+
+// Finds the command message invokes ("name" or "name argument"), storing its
+// argument; returns nullptr for messages that are not commands.
+inline const Command* find_command(std::string_view message, std::string_view& argument) {
+    size_t space = message.find(' ');
+    std::string_view name = message.substr(0, space);
+    for (const Command& command : COMMANDS) {
+        if (command.name == name) {
+            argument = space == std::string_view::npos ? std::string_view() : message.substr(space + 1);
+            return &command;
+        }
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef FRAMING_HPP
+#define FRAMING_HPP
+
+// Newline-delimited message framing shared by the server and the client.
+//
+// A message is every byte up to the next '\n' (a '\r' right before it is
+// dropped too, so telnet-style CRLF lines work). TCP is a byte stream: one
+// recv() may carry many messages, or only part of one, so received bytes go
+// through a LineFramer that hands out complete messages and keeps the rest.
+// Messages are handed out as views into the framer's buffer, so framing
+// itself copies nothing.
+
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "buffer_pool.hpp"
+
+constexpr size_t MAX_MESSAGE_SIZE = 1 << 20; // Longer lines are treated as a protocol error
+
+class LineFramer {
+public:
+    // Without a pool the framer keeps its buffer for its whole life.
+    explicit LineFramer(BufferPool* pool = nullptr) : buffer_(pool) {}
+
+    // Adds bytes just received. Invalidates views handed out by next().
+    void append(const char* data, size_t size) {
+        discard_taken();
+        buffer_.append(data, size);
+    }
+
+    // Lets recv() write straight into the framer: prepare() room for n bytes,
+    // then commit() what arrived. Invalidates views handed out by next().
+    char* prepare(size_t n) {
+        discard_taken();
+        return buffer_.prepare(n);
+    }
+    size_t room() const { return buffer_.room(); } // Writable bytes after prepare()
+    void commit(size_t n) { buffer_.commit(n); }
+
+    // Points message at the next complete message (without its line ending),
+    // inside the framer's buffer. The view stays valid until the next
+    // append() or prepare(), and its terminator ("\n" or "\r\n") follows it in
+    // memory. Returns false if no complete message is buffered yet.
+    bool next(std::string_view& message) {
+        const char* data = buffer_.data();
+        size_t size = buffer_.size();
+        const void* newline = scan_ < size ? memchr(data + scan_, '\n', size - scan_) : nullptr;
+        if (newline == nullptr) {
+            scan_ = size; // Do not rescan these bytes next time
+            return false;
+        }
+        size_t end = static_cast<size_t>(static_cast<const char*>(newline) - data);
+        size_t after = end + 1;
+        if (end > taken_ && data[end - 1] == '\r') {
+            --end;
+        }
+        message = std::string_view(data + taken_, end - taken_);
+        taken_ = scan_ = after;
+        return true;
+    }
+
+    // Copies the next complete message into message instead.
+    bool next(std::string& message) {
+        std::string_view view;
+        if (!next(view)) {
+            return false;
+        }
+        message.assign(view.data(), view.size());
+        return true;
+    }
+
+    // True if next() would return a message.
+    bool has_message() const {
+        size_t size = buffer_.size();
+        return scan_ < size && memchr(buffer_.data() + scan_, '\n', size - scan_) != nullptr;
+    }
+
+    // Received bytes not yet handed out as messages.
+    size_t buffered() const { return buffer_.size() - taken_; }
+
+    // Bytes of a message still being received, as far as next() has looked.
+    size_t unterminated() const { return scan_ - taken_; }
+
+    // True once an unterminated message has grown past MAX_MESSAGE_SIZE.
+    // Only bytes next() has searched count, so complete messages a caller
+    // has not asked for yet never look like an overlong one.
+    bool overflowed() const {
+        return unterminated() > MAX_MESSAGE_SIZE;
+    }
+
+    // Drops handed-out messages and, if nothing partial remains, returns the
+    // buffer's pool block. Invalidates views handed out by next().
+    void trim() {
+        discard_taken();
+        buffer_.trim();
+    }
+
+private:
+    // Drops the messages already handed out.
+    void discard_taken() {
+        if (taken_ > 0) {
+            buffer_.consume(taken_);
+            scan_ -= taken_;
+            taken_ = 0;
+        }
+    }
+
+    ByteBuffer buffer_;
+    size_t taken_ = 0; // Bytes of complete messages already handed out
+    size_t scan_ = 0;  // Where the search for the next '\n' resumes
+};
+
+// Sends all of data on a blocking socket, retrying partial writes.
+// Returns false (with errno set) on error.
+inline bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,415 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+// Asynchronous structured logging for the server.
+//
+// Every thread that logs gets its own single-producer ring of fixed-size
+// records, so logging never takes a lock or waits for the terminal: the
+// calling thread formats one line into a free slot and moves on. A
+// background writer drains all rings and writes the lines in large batches
+// (info and below to stdout, warnings and errors to stderr). When a ring is
+// full the entry is dropped and counted instead of blocking the data path.
+//
+// Lines look like
+//     2026-01-02T03:04:05.678901Z INFO received peer=127.0.0.1:5000 message="hi there"
+// Before start() and after stop() entries are written synchronously instead.
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "thread_slots.hpp"
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+constexpr size_t LOG_RECORD_SIZE = 256;    // Bytes per ring slot; longer lines are truncated
+constexpr size_t LOG_RING_RECORDS = 1024;  // Slots per thread (a power of two)
+constexpr size_t LOG_WRITE_BUFFER = 64 * 1024;
+constexpr auto LOG_IDLE_SLEEP = std::chrono::milliseconds(1);   // Writer's nap when every ring is empty
+constexpr auto LOG_DROP_REPORT = std::chrono::seconds(1);       // Least time between drop reports
+
+inline const char* log_level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO";
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    default: return "OFF";
+    }
+}
+
+// Parses "debug", "info", "warn", "error" or "off"; returns false otherwise.
+inline bool parse_log_level(std::string_view text, LogLevel& level) {
+    static const LogLevel levels[] = {LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error, LogLevel::Off};
+    static const char* names[] = {"debug", "info", "warn", "error", "off"};
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        if (text == names[i]) {
+            level = levels[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// One key=value pair of a log line. Values are borrowed, not copied, so a
+// field must not outlive what it points at; the log call copies them.
+struct LogField {
+    LogField(const char* key, std::string_view text) : key(key), text(text) {}
+    LogField(const char* key, const char* text) : key(key), text(text) {}
+    LogField(const char* key, const std::string& text) : key(key), text(text) {}
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    LogField(const char* key, T number) : key(key), number(static_cast<long long>(number)), is_number(true) {}
+
+    const char* key;
+    std::string_view text;
+    long long number = 0;
+    bool is_number = false;
+};
+
+struct LogRecord {
+    uint64_t time_ns;  // Wall-clock time of the call
+    LogLevel level;
+    uint16_t size;     // Bytes used in text
+    char text[LOG_RECORD_SIZE - sizeof(uint64_t) - sizeof(uint32_t)];
+};
+
+// Writes text into a fixed buffer, remembering whether anything was cut off.
+class LogLineWriter {
+public:
+    LogLineWriter(char* out, size_t capacity) : out_(out), capacity_(capacity) {}
+
+    void put(std::string_view text) {
+        size_t n = std::min(text.size(), capacity_ - size_);
+        memcpy(out_ + size_, text.data(), n);
+        size_ += n;
+        truncated_ |= n < text.size();
+    }
+
+    void put(char c) { put(std::string_view(&c, 1)); }
+
+    void put(long long number) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        put(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+    }
+
+    // Writes a field value, quoting and escaping it when it is not a plain word.
+    void put_value(std::string_view text) {
+        bool plain = !text.empty();
+        for (char c : text) {
+            if (c == ' ' || c == '"' || c == '=' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                plain = false;
+                break;
+            }
+        }
+        if (plain) {
+            put(text);
+            return;
+        }
+        put('"');
+        for (char c : text) {
+            if (truncated_) {
+                return;
+            }
+            switch (c) {
+            case '"': put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    char escaped[] = {'\\', 'x', hex[(c >> 4) & 0xf], hex[c & 0xf]};
+                    put(std::string_view(escaped, sizeof(escaped)));
+                } else {
+                    put(c);
+                }
+            }
+        }
+        put('"');
+    }
+
+    // Marks a cut-off line with "..." in its last bytes.
+    size_t finish() {
+        if (truncated_ && capacity_ >= 3) {
+            memcpy(out_ + capacity_ - 3, "...", 3);
+            size_ = capacity_;
+        }
+        return size_;
+    }
+
+private:
+    char* out_;
+    size_t capacity_;
+    size_t size_ = 0;
+    bool truncated_ = false;
+};
+
+// A bounded single-producer, single-consumer queue of log records.
+class LogRing {
+public:
+    LogRing() : records_(new LogRecord[LOG_RING_RECORDS]) {}
+
+    // Producer: a free slot, or nullptr if the ring is full.
+    LogRecord* claim() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= LOG_RING_RECORDS) {
+            return nullptr;
+        }
+        return &records_[head & (LOG_RING_RECORDS - 1)];
+    }
+    void publish() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: the oldest record, or nullptr if the ring is empty.
+    const LogRecord* front() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &records_[tail & (LOG_RING_RECORDS - 1)];
+    }
+    void pop() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    std::unique_ptr<LogRecord[]> records_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+class Logger {
+public:
+    // The process-wide logger. It is never destroyed, so detached threads may
+    // keep logging while the process exits.
+    static Logger& instance() {
+        static Logger* logger = new Logger();
+        return *logger;
+    }
+
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    // Lets through one in every n sampled entries (see sampled()).
+    void set_sample_every(uint32_t n) { sample_every_.store(n == 0 ? 1 : n, std::memory_order_relaxed); }
+
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed) && level != LogLevel::Off; }
+
+    // For high-volume entries: true once every sample_every calls on this thread.
+    bool sampled() {
+        thread_local uint32_t counter = 0;
+        if (++counter < sample_every_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        counter = 0;
+        return true;
+    }
+
+    // Starts the background writer.
+    void start() {
+        if (!running_.exchange(true)) {
+            writer_ = std::thread(&Logger::run_writer, this);
+        }
+    }
+
+    // Stops the writer after it has written everything logged so far.
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        writer_.join();
+        drain();
+        report_drops();
+    }
+
+    void log(LogLevel level, std::string_view event, std::initializer_list<LogField> fields) {
+        if (!enabled(level)) {
+            return;
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            LogRecord record;
+            fill(record, level, event, fields);
+            write_now(record);
+            return;
+        }
+        LogRing* ring = thread_ring();
+        LogRecord* record = ring->claim();
+        if (record == nullptr) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        fill(*record, level, event, fields);
+        ring->publish();
+    }
+
+    // Entries dropped so far because a ring was full.
+    uint64_t dropped() {
+        uint64_t total = 0;
+        rings_.for_each([&total](LogRing& ring) { total += ring.dropped.load(std::memory_order_relaxed); });
+        return total;
+    }
+
+private:
+    struct Output {
+        explicit Output(int fd) : fd(fd) {}
+
+        int fd;
+        char data[LOG_WRITE_BUFFER];
+        size_t size = 0;
+    };
+
+    Logger() = default;
+
+    static uint64_t now_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static void fill(LogRecord& record, LogLevel level, std::string_view event, std::initializer_list<LogField> fields) {
+        record.time_ns = now_ns();
+        record.level = level;
+        LogLineWriter line(record.text, sizeof(record.text));
+        line.put(event);
+        for (const LogField& field : fields) {
+            line.put(' ');
+            line.put(field.key);
+            line.put('=');
+            if (field.is_number) {
+                line.put(field.number);
+            } else {
+                line.put_value(field.text);
+            }
+        }
+        record.size = static_cast<uint16_t>(line.finish());
+    }
+
+    // The calling thread's ring: adopted from an exited thread if possible.
+    LogRing* thread_ring() { return &rings_.local(); }
+
+    // Formats record as one output line: timestamp, level, then its text.
+    static void append_line(Output& out, const LogRecord& record) {
+        constexpr size_t PREFIX = 40; // "2026-01-02T03:04:05.678901Z ERROR "
+        if (out.size + PREFIX + record.size + 1 > sizeof(out.data)) {
+            flush(out);
+        }
+        time_t seconds = static_cast<time_t>(record.time_ns / 1000000000ull);
+        struct tm utc;
+        gmtime_r(&seconds, &utc);
+        char* p = out.data + out.size;
+        size_t n = strftime(p, PREFIX, "%Y-%m-%dT%H:%M:%S", &utc);
+        n += static_cast<size_t>(snprintf(p + n, PREFIX - n, ".%06uZ %s ",
+                                          static_cast<unsigned>(record.time_ns % 1000000000ull / 1000),
+                                          log_level_name(record.level)));
+        memcpy(p + n, record.text, record.size);
+        n += record.size;
+        p[n++] = '\n';
+        out.size += n;
+    }
+
+    static void flush(Output& out) {
+        size_t written = 0;
+        while (written < out.size) {
+            ssize_t n = ::write(out.fd, out.data + written, out.size - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break; // Nowhere to report it; drop the batch
+            }
+            written += static_cast<size_t>(n);
+        }
+        out.size = 0;
+    }
+
+    static void write_now(const LogRecord& record) {
+        Output out(record.level >= LogLevel::Warn ? STDERR_FILENO : STDOUT_FILENO);
+        append_line(out, record);
+        flush(out);
+    }
+
+    // Writes out everything queued; returns whether there was anything.
+    // Only one thread drains at a time: the writer, or stop() once it has exited.
+    bool drain() {
+        bool any = false;
+        rings_.for_each([this, &any](LogRing& ring) {
+            while (const LogRecord* record = ring.front()) {
+                append_line(record->level >= LogLevel::Warn ? errors_ : lines_, *record);
+                ring.pop();
+                any = true;
+            }
+        });
+        flush(lines_);
+        flush(errors_);
+        return any;
+    }
+
+    void report_drops() {
+        uint64_t total = dropped();
+        if (total > reported_drops_) {
+            uint64_t recent = total - reported_drops_;
+            reported_drops_ = total;
+            log(LogLevel::Warn, "log entries dropped", {{"count", recent}, {"total", total}});
+        }
+    }
+
+    void run_writer() {
+        auto last_report = std::chrono::steady_clock::now();
+        while (running_.load(std::memory_order_acquire)) {
+            bool any = drain();
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_report >= LOG_DROP_REPORT) {
+                report_drops();
+                last_report = now;
+            }
+            if (!any) {
+                std::this_thread::sleep_for(LOG_IDLE_SLEEP);
+            }
+        }
+    }
+
+    std::atomic<LogLevel> level_{LogLevel::Info};
+    std::atomic<uint32_t> sample_every_{1};
+    std::atomic<bool> running_{false};
+    ThreadSlots<LogRing> rings_;
+    std::thread writer_;
+    uint64_t reported_drops_ = 0; // Writer thread only (and stop(), after the writer has exited)
+    Output lines_{STDOUT_FILENO};
+    Output errors_{STDERR_FILENO};
+};
+
+inline void log_debug(std::string_view event, std::initializer_list<LogField> fields = {}) {
+    Logger::instance().log(LogLevel::Debug, event, fields);
+}
+inline void log_info(std::string_view event, std::initializer_list<LogField> fields = {}) {
+    Logger::instance().log(LogLevel::Info, event, fields);
+}
+inline void log_warn(std::string_view event, std::initializer_list<LogField> fields = {}) {
+    Logger::instance().log(LogLevel::Warn, event, fields);
+}
+inline void log_error(std::string_view event, std::initializer_list<LogField> fields = {}) {
+    Logger::instance().log(LogLevel::Error, event, fields);
+}
+
+// For per-message entries: logs only one in every --log-sample calls per thread.
+inline void log_sampled(LogLevel level, std::string_view event, std::initializer_list<LogField> fields = {}) {
+    Logger& logger = Logger::instance();
+    if (logger.enabled(level) && logger.sampled()) {
+        logger.log(level, event, fields);
+    }
+}
+
+#endif
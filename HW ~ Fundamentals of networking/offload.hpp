@@ -0,0 +1,153 @@
+#ifndef OFFLOAD_HPP
+#define OFFLOAD_HPP
+
+// Handing expensive commands from a reactor to the compute pool and back.
+//
+// A reactor never waits for a job. The job runs on a pool worker and posts
+// its reply, tagged with the connection and the reply's position, to the
+// reactor's CompletionChannel: a lock-free queue plus an eventfd that the
+// reactor watches next to its sockets. Each connection keeps a ReplyQueue so
+// that replies leave in the order the requests arrived, however the jobs
+// finish: once a job is outstanding, later replies (even plain echoes) wait
+// in the queue behind it.
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "MpmcQueue.hpp"
+
+struct Completion {
+    int fd = -1;             // The connection's descriptor, to find it
+    uint64_t connection = 0; // The connection's id, in case the descriptor was reused meanwhile
+    uint64_t seq = 0;        // The reply's position in the connection's ReplyQueue
+    std::string reply;       // Newline included
+};
+
+// Carries finished jobs from pool workers (any number) to one reactor.
+// Wakeups coalesce: only the first post after a drain writes the eventfd.
+class CompletionChannel {
+public:
+    explicit CompletionChannel(size_t capacity)
+        : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), queue_(capacity), capacity_(queue_.Capacity()) {}
+    CompletionChannel(const CompletionChannel&) = delete;
+    CompletionChannel& operator=(const CompletionChannel&) = delete;
+    ~CompletionChannel() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool valid() const { return fd_ >= 0; }
+    int fd() const { return fd_; } // Readable while completions wait
+
+    // Reactor side: claims room for one more job's completion. Returns false
+    // when every slot is taken.
+    bool reserve() {
+        if (in_flight_.load(std::memory_order_relaxed) >= capacity_) {
+            return false;
+        }
+        in_flight_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Worker side: delivers the completion of a job that reserve() admitted.
+    void post(Completion&& done) {
+        while (!queue_.TryPush(std::move(done))) {
+            std::this_thread::yield(); // Cannot happen while reservations are honoured
+        }
+        if (!signalled_.exchange(true)) {
+            uint64_t one = 1;
+            ssize_t written = write(fd_, &one, sizeof(one));
+            (void)written; // Only fails if the counter is saturated, which is a wakeup anyway
+        }
+    }
+
+    // Reactor side: after a wakeup, hands every waiting completion to on_completion.
+    template <typename Fn>
+    size_t drain(Fn&& on_completion) {
+        uint64_t count;
+        ssize_t got = read(fd_, &count, sizeof(count));
+        (void)got; // EAGAIN: an earlier drain already took what this wakeup announced
+        signalled_.store(false); // Posts from here on wake the reactor again
+        size_t drained = 0;
+        Completion done;
+        while (queue_.TryPop(done)) {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            on_completion(done);
+            ++drained;
+        }
+        return drained;
+    }
+
+private:
+    int fd_;
+    BoundedMpmcQueue<Completion> queue_;
+    size_t capacity_;
+    std::atomic<size_t> in_flight_{0}; // Reserved jobs whose completions were not drained yet
+    std::atomic<bool> signalled_{false};
+};
+
+// A connection's replies in request order, some still being computed.
+// Only the owning reactor touches it.
+class ReplyQueue {
+public:
+    // True when nothing is queued, so replies may go straight out.
+    bool idle() const { return slots_.empty(); }
+
+    // Bytes of finished replies held back behind an unfinished one.
+    size_t size() const { return bytes_; }
+
+    // Holds a place for a reply being computed; returns its sequence number.
+    uint64_t reserve() {
+        slots_.push_back(Slot{false, std::string()});
+        return base_ + slots_.size() - 1;
+    }
+
+    // Queues a reply that is already known.
+    void add_ready(std::string_view reply) {
+        slots_.push_back(Slot{true, std::string(reply)});
+        bytes_ += reply.size();
+    }
+
+    // Fills the place reserved under seq.
+    void complete(uint64_t seq, std::string&& reply) {
+        if (seq < base_ || seq - base_ >= slots_.size()) {
+            return;
+        }
+        Slot& slot = slots_[seq - base_];
+        bytes_ += reply.size();
+        slot.reply = std::move(reply);
+        slot.ready = true;
+    }
+
+    // Hands the finished replies at the front, in order, to emit(reply).
+    template <typename Fn>
+    void release(Fn&& emit) {
+        while (!slots_.empty() && slots_.front().ready) {
+            emit(std::string_view(slots_.front().reply));
+            bytes_ -= slots_.front().reply.size();
+            slots_.pop_front();
+            ++base_;
+        }
+    }
+
+private:
+    struct Slot {
+        bool ready;
+        std::string reply;
+    };
+
+    std::deque<Slot> slots_;
+    uint64_t base_ = 0; // Sequence number of slots_.front()
+    size_t bytes_ = 0;
+};
+
+#endif
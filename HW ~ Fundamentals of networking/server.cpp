@@ -10,93 +10,521 @@
 #include <arpa/inet.h>
 #include <csignal>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <sched.h>
+#include <new>
+#include <string_view>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <poll.h>
+
+#include "SimpleThreadPool.hpp"
+#include "commands.hpp"
+#include "framing.hpp"
+#include "logger.hpp"
+#include "offload.hpp"
+#include "shm_ring.hpp"
+#include "stats.hpp"
+#include "timer_wheel.hpp"
+#include "uring.hpp"
 
 constexpr int PORT = 8080;
-constexpr int BUFFER_SIZE = 1024;
-constexpr int BACKLOG = 5; // Max pending connections queue size
+constexpr size_t RECV_MIN_SPACE = 4096; // Least room offered to recv(); it fills whatever the buffer has free
+constexpr int DEFAULT_BACKLOG = SOMAXCONN; // Max pending connections queue size (capped by net.core.somaxconn)
+constexpr int MAX_EVENTS = 256;        // epoll events handled per epoll_wait call
+constexpr int EPOLL_TIMEOUT_MS = 200;  // How often event loops check g_running
+constexpr size_t DEFAULT_HIGH_WATERMARK = 256 * 1024; // Pending output at which a connection stops being read
+constexpr size_t DEFAULT_LOW_WATERMARK = 64 * 1024;   // Pending output below which reading resumes
+constexpr size_t DEFAULT_MEMORY_BUDGET_MB = 256;      // Bytes buffered across all connections, in MiB
+constexpr int DEFAULT_MAX_CONNECTIONS = 10000;
+constexpr int DEFAULT_IDLE_TIMEOUT_S = 60; // Silence after which a connection is closed
+constexpr int DEFAULT_READ_TIMEOUT_S = 10; // Time allowed to finish a message once it has started
+constexpr uint64_t TIMER_TICK_MS = 100;    // Resolution of connection timeouts
+constexpr size_t MAX_JOBS_PER_REACTOR = 1024; // Offloaded commands in flight per reactor; more are refused
+constexpr int SHM_HANDSHAKE_TIMEOUT_S = 5;    // Time a shared-memory client has to offer its region
+constexpr auto SHM_SPIN = std::chrono::microseconds(50); // Polling of idle rings before sleeping (multi-core only)
 
 // Global flag to signal server shutdown
 std::atomic<bool> g_running = true;
 
+// Every operator new is counted so that the shutdown report can show that
+// serving messages does not allocate. In the steady state nothing increments
+// it, so the shared counter costs nothing there.
+std::atomic<uint64_t> g_heap_allocations{0};
+std::atomic<uint64_t> g_messages_served{0}; // Added to once per connection or loop, not per message
+
+// Shared by every reactor for the server-wide limits.
+std::atomic<size_t> g_buffered_bytes{0}; // Received and reply bytes held for all connections
+std::atomic<int> g_connection_count{0};
+
+// Runs offloaded commands for every reactor; null when all commands run inline.
+SimpleThreadPool* g_compute_pool = nullptr;
+
+void* operator new(size_t size) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+// Kept out of line: inlined, GCC sees free() on memory from operator new and warns.
+__attribute__((noinline)) void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+__attribute__((noinline)) void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+// How connections are served
+enum class ServerMode {
+    Threads, // One blocking std::thread per client (the original design)
+    Epoll,   // A few event-loop threads with non-blocking, edge-triggered sockets
+    Uring    // The same reactor threads driving io_uring (falls back to Epoll if unsupported)
+};
+
+struct ServerConfig {
+    ServerMode mode = ServerMode::Epoll;
+    int threads = 0; // Event-loop threads in epoll mode; 0 = one per core
+    int backlog = DEFAULT_BACKLOG;
+    bool pin_threads = true; // Pin event loop i to the i-th CPU this process may run on
+    LogLevel log_level = LogLevel::Info;
+    uint32_t log_sample = 1; // Log one in every log_sample received messages
+    // Backpressure (reactor modes): a connection whose unsent replies reach
+    // high_watermark is not read again until they drop to low_watermark, and
+    // no connection is read while memory_budget bytes are buffered in total.
+    size_t high_watermark = DEFAULT_HIGH_WATERMARK;
+    size_t low_watermark = DEFAULT_LOW_WATERMARK;
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET_MB << 20;
+    int max_connections = DEFAULT_MAX_CONNECTIONS; // Further clients are closed right after accept
+    int idle_timeout = DEFAULT_IDLE_TIMEOUT_S; // Seconds; 0 = never
+    int read_timeout = DEFAULT_READ_TIMEOUT_S; // Seconds; 0 = never (reactor modes only)
+    int workers = -1; // Compute pool threads (reactor modes); -1 = one per core, 0 = run every command inline
+    std::string unix_path; // Also serve clients on this Unix socket; empty = TCP only
+    std::string shm_path;  // Accept shared-memory clients on this Unix socket; empty = none
+};
+
+bool over_memory_budget(const ServerConfig& config) {
+    return g_buffered_bytes.load(std::memory_order_relaxed) >= config.memory_budget;
+}
+
+// Moves one connection's share of g_buffered_bytes from charged to now bytes.
+void charge_buffered(size_t& charged, size_t now) {
+    if (now > charged) {
+        g_buffered_bytes.fetch_add(now - charged, std::memory_order_relaxed);
+    } else if (now < charged) {
+        g_buffered_bytes.fetch_sub(charged - now, std::memory_order_relaxed);
+    }
+    charged = now;
+}
+
+// Takes a connection slot; returns false (taking nothing) if all max_connections are in use.
+bool admit_connection(const ServerConfig& config) {
+    StatsShard& stats = ServerStats::instance().shard();
+    if (g_connection_count.fetch_add(1, std::memory_order_relaxed) >= config.max_connections) {
+        g_connection_count.fetch_sub(1, std::memory_order_relaxed);
+        stats.count_reject();
+        return false;
+    }
+    stats.count_accept();
+    return true;
+}
+
+void release_connection() {
+    g_connection_count.fetch_sub(1, std::memory_order_relaxed);
+    ServerStats::instance().shard().count_close();
+}
+
+// The timer wheels' clock: a cheap, coarse monotonic time in TIMER_TICK_MS ticks.
+uint64_t current_tick() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint64_t ms = static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+    return ms / TIMER_TICK_MS;
+}
+
+uint64_t seconds_to_ticks(int seconds) {
+    return static_cast<uint64_t>(seconds) * 1000 / TIMER_TICK_MS;
+}
+
+// Timeout state of one reactor connection. Activity only moves the deadline;
+// the wheel entry is re-filed when the deadline gets earlier, and a later
+// deadline is picked up when the old entry fires, so most messages cost no
+// list operation at all.
+struct ConnectionTimer {
+    TimerNode node;
+    uint64_t deadline = 0;     // Tick after which the connection is closed
+    bool reading = false;      // Part of a message has arrived
+    uint64_t read_started = 0; // Tick the unfinished message started
+};
+
+// Records activity: the deadline becomes the idle timeout from now, or the
+// read timeout from when the unfinished message (if any) started, whichever is sooner.
+void touch_timer(TimerWheel& wheel, ConnectionTimer& timer, const ServerConfig& config, bool partial) {
+    uint64_t now = wheel.now();
+    uint64_t deadline = UINT64_MAX;
+    if (config.idle_timeout > 0) {
+        deadline = now + seconds_to_ticks(config.idle_timeout);
+    }
+    if (!partial) {
+        timer.reading = false;
+    } else {
+        if (!timer.reading) {
+            timer.reading = true;
+            timer.read_started = now;
+        }
+        if (config.read_timeout > 0) {
+            deadline = std::min(deadline, timer.read_started + seconds_to_ticks(config.read_timeout));
+        }
+    }
+    timer.deadline = deadline;
+    if (deadline == UINT64_MAX) {
+        wheel.cancel(&timer.node);
+    } else if (!timer.node.scheduled() || deadline < timer.node.expires) {
+        wheel.schedule(&timer.node, deadline);
+    }
+}
+
+// For a wheel entry that fired: true if the connection really is past its
+// deadline, otherwise re-files the entry at the (later) deadline.
+bool timer_expired(TimerWheel& wheel, ConnectionTimer& timer) {
+    if (timer.deadline > wheel.now()) {
+        wheel.schedule(&timer.node, timer.deadline);
+        return false;
+    }
+    return true;
+}
+
+void log_timeout(const std::string& peer, const ConnectionTimer& timer) {
+    log_info("connection timed out", {{"peer", peer}, {"reason", timer.reading ? "read" : "idle"}});
+}
+
+constexpr std::string_view HELLO_MESSAGE = "hello";
+constexpr std::string_view WORLD_REPLY = "world\n";
+constexpr int REPLY_IOVECS = 64; // Reply segments gathered per sendmsg()
+
+// Appends the reply to one message (given without its line ending) to out.
+void append_response(std::string& out, std::string_view message) {
+    if (message == HELLO_MESSAGE) {
+        out.append(WORLD_REPLY.data(), WORLD_REPLY.size());
+    } else {
+        out.append(message.data(), message.size());
+        out += '\n'; // Echo back with newline
+    }
+}
+
+// Gathers replies as iovecs and writes them with as few sendmsg() calls as
+// possible. Echoes are sent straight from the receive buffer: the reply to
+// "abc\n" is the very bytes received. Whatever a non-blocking socket does not
+// take right away is copied to backlog, and once the backlog holds data,
+// later replies queue behind it so that they stay in order.
+class ReplyWriter {
+public:
+    ReplyWriter(int fd, ByteBuffer& backlog, StatsShard& stats) : fd_(fd), backlog_(backlog), stats_(stats) {}
+
+    // Queues the reply to message, a view handed out by LineFramer::next().
+    void reply_to(std::string_view message) {
+        if (message == HELLO_MESSAGE) {
+            add(WORLD_REPLY.data(), WORLD_REPLY.size());
+        } else if (message.data()[message.size()] == '\n') {
+            add(message.data(), message.size() + 1); // The received line, newline included
+        } else {
+            add(message.data(), message.size()); // A CRLF line: leave the '\r' out
+            add("\n", 1);
+        }
+    }
+
+    // Queues a reply that only lives until this call returns (a command's
+    // output), sending it together with everything queued before it.
+    bool reply_with(std::string_view reply) {
+        add(reply.data(), reply.size());
+        return flush();
+    }
+
+    // Sends everything queued. Returns false (with errno set) on a fatal socket error.
+    bool flush() {
+        int first = 0;
+        bool failed = false;
+        while (first < count_) {
+            struct msghdr msg{};
+            msg.msg_iov = iov_ + first;
+            msg.msg_iovlen = static_cast<size_t>(count_ - first);
+            ssize_t sent = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                failed = errno != EAGAIN && errno != EWOULDBLOCK;
+                break;
+            }
+            stats_.count_bytes_out(static_cast<size_t>(sent));
+            size_t left = static_cast<size_t>(sent);
+            while (first < count_ && left >= iov_[first].iov_len) {
+                left -= iov_[first].iov_len;
+                ++first;
+            }
+            if (left > 0) {
+                iov_[first].iov_base = static_cast<char*>(iov_[first].iov_base) + left;
+                iov_[first].iov_len -= left;
+            }
+        }
+        for (int i = first; i < count_ && !failed; ++i) {
+            backlog_.append(static_cast<const char*>(iov_[i].iov_base), iov_[i].iov_len);
+        }
+        count_ = 0;
+        return !failed;
+    }
+
+private:
+    void add(const char* data, size_t size) {
+        if (count_ > 0) {
+            struct iovec& last = iov_[count_ - 1];
+            if (static_cast<const char*>(last.iov_base) + last.iov_len == data) {
+                last.iov_len += size; // Consecutive echoes are one contiguous run of the buffer
+                return;
+            }
+        }
+        if (count_ == REPLY_IOVECS) {
+            flush(); // A failure here shows up again in the caller's final flush()
+        }
+        if (!backlog_.empty()) {
+            backlog_.append(data, size);
+            return;
+        }
+        iov_[count_].iov_base = const_cast<char*>(data);
+        iov_[count_].iov_len = size;
+        ++count_;
+    }
+
+    int fd_;
+    ByteBuffer& backlog_;
+    StatsShard& stats_;
+    struct iovec iov_[REPLY_IOVECS];
+    int count_ = 0;
+};
+
+// How a reactor answers a message.
+enum class Dispatch {
+    Inline,    // On the reactor thread
+    Offloaded, // A compute pool job answers later
+    Busy       // Every job slot of the reactor is taken: answer BUSY_REPLY
+};
+
+constexpr std::string_view BUSY_REPLY = "error: server busy\n";
+
+// Appends the reply to message to out, running command (if it names one) on
+// the calling thread.
+void run_inline(const Command* command, std::string_view argument, std::string_view message, Dispatch how,
+                std::string& out) {
+    if (how == Dispatch::Busy) {
+        out.append(BUSY_REPLY.data(), BUSY_REPLY.size());
+        return;
+    }
+    if (command == nullptr) {
+        append_response(out, message);
+        return;
+    }
+    command->run(argument, out);
+    out += '\n';
+}
+
+// Starts command (if any) as a compute pool job when it is an Offload command
+// and the reactor has a channel: its reply reaches the reactor through
+// channel later, for the place it reserved in replies. A full channel makes
+// the command fail fast rather than run on (and stall) the reactor.
+Dispatch offload_command(const Command* command, std::string_view argument,
+                         const std::shared_ptr<CompletionChannel>& channel, int fd, uint64_t connection,
+                         ReplyQueue& replies) {
+    if (command == nullptr || command->kind != HandlerKind::Offload || g_compute_pool == nullptr || !channel) {
+        return Dispatch::Inline;
+    }
+    if (!channel->reserve()) {
+        return Dispatch::Busy;
+    }
+    uint64_t seq = replies.reserve();
+    // The job owns a copy of the argument and a share of the channel, so it
+    // may outlive the connection and even the reactor.
+    g_compute_pool->Execute([channel, run = command->run, text = std::string(argument), fd, connection, seq]() {
+        if (!g_running.load(std::memory_order_relaxed)) {
+            return; // Shutting down: nobody waits for the reply, so skip the work
+        }
+        uint64_t started = stats_clock_ns(); // Always timed: the hashing dwarfs the clock reads
+        Completion done;
+        done.fd = fd;
+        done.connection = connection;
+        done.seq = seq;
+        run(text, done.reply);
+        done.reply += '\n';
+        ServerStats::instance().shard().count_answer(started);
+        channel->post(std::move(done));
+    });
+    return Dispatch::Offloaded;
+}
+
 // Function to handle client connections
-void handle_client(int client_socket, struct sockaddr_in client_addr) {
-    char buffer[BUFFER_SIZE];
-    char client_ip[INET_ADDRSTRLEN];
+void handle_client(int client_socket, std::string peer, int idle_timeout) {
+    log_info("connection accepted", {{"peer", peer}});
 
-    // Convert client IP to string for logging
-    inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
-    int client_port = ntohs(client_addr.sin_port);
-    std::cout << "Connection accepted from " << client_ip << ":" << client_port << std::endl;
+    // A blocking thread needs no wheel: the kernel times out its recv().
+    if (idle_timeout > 0) {
+        struct timeval timeout{};
+        timeout.tv_sec = idle_timeout;
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
 
+    LineFramer framer;
+    ByteBuffer backlog; // Stays empty: blocking sends take everything
+    std::string_view message;
+    std::string_view argument;
+    std::string reply; // A command's output
+    uint64_t messages = 0;
+    bool sent = true;
+    StatsShard& stats = ServerStats::instance().shard();
     while (g_running) {
-        memset(buffer, 0, BUFFER_SIZE);
-        // Receive data from client
-        ssize_t bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        // Receive data from client, straight into the framer's buffer
+        char* space = framer.prepare(RECV_MIN_SPACE);
+        ssize_t bytes_received = recv(client_socket, space, framer.room(), 0);
 
         if (bytes_received <= 0) {
             if (bytes_received == 0) {
-                std::cout << "Client " << client_ip << ":" << client_port << " disconnected." << std::endl;
+                log_info("client disconnected", {{"peer", peer}});
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                log_info("connection timed out", {{"peer", peer}, {"reason", "idle"}});
             } else {
-                std::cerr << "Error receiving from client " << client_ip << ":" << client_port << ": " << strerror(errno) << std::endl;
+                log_error("receive failed", {{"peer", peer}, {"error", strerror(errno)}});
+                stats.count_recv_error();
             }
             break; // Exit loop on error or disconnect
         }
 
-        // Null-terminate the received data to treat as string
-        buffer[bytes_received] = '\0';
-        std::string message(buffer);
-
-        // Trim potential trailing newline characters from client input
-        while (!message.empty() && (message.back() == '\n' || message.back() == '\r')) {
-             message.pop_back();
+        // One recv may hold many messages, or only part of one
+        framer.commit(static_cast<size_t>(bytes_received));
+        stats.count_bytes_in(static_cast<size_t>(bytes_received));
+        // This thread serves only this client, so commands run right here.
+        ReplyWriter replies(client_socket, backlog, stats);
+        while (framer.next(message)) {
+            log_sampled(LogLevel::Info, "received", {{"peer", peer}, {"message", message}});
+            stats.count_message_in();
+            uint64_t started = stats.start_handler();
+            const Command* command = find_command(message, argument);
+            if (command == nullptr) {
+                replies.reply_to(message);
+            } else {
+                reply.clear();
+                run_inline(command, argument, message, Dispatch::Inline, reply);
+                sent = replies.reply_with(reply) && sent;
+            }
+            stats.count_answer(started);
+            ++messages;
         }
-        std::cout << "Received from " << client_ip << ":" << client_port << ": " << message << std::endl;
-
-
-        std::string response;
-        if (message == "hello") {
-            response = "world\n";
-        } else {
-            response = message + "\n"; // Echo back with newline
+        if (framer.overflowed()) {
+            log_error("message too long", {{"peer", peer}, {"limit", MAX_MESSAGE_SIZE}});
+            break;
         }
 
-        // Send response back to client
-        ssize_t bytes_sent = send(client_socket, response.c_str(), response.length(), 0);
-        if (bytes_sent < 0) {
-            std::cerr << "Error sending to client " << client_ip << ":" << client_port << ": " << strerror(errno) << std::endl;
+        // Send every reply to this batch at once, retrying partial writes
+        if (!replies.flush() || !sent) {
+            log_error("send failed", {{"peer", peer}, {"error", strerror(errno)}});
+            stats.count_send_error();
             break; // Exit loop on send error
-        } else if (static_cast<size_t>(bytes_sent) != response.length()) {
-             std::cerr << "Warning: Partial send to client " << client_ip << ":" << client_port << std::endl;
-             // In a real-world scenario, you might loop here to send remaining bytes
         }
     }
 
     // Cleanup: Close the client socket
+    g_messages_served.fetch_add(messages, std::memory_order_relaxed);
     close(client_socket);
-    std::cout << "Closed connection for " << client_ip << ":" << client_port << std::endl;
+    release_connection();
+    log_info("connection closed", {{"peer", peer}, {"messages", messages}});
 }
 
-// Signal handler for graceful shutdown
-void signal_handler(int signum) {
-    std::cout << "\nCaught signal " << signum << ". Shutting down server..." << std::endl;
-    g_running = false;
-    // Might need additional mechanisms to interrupt the accept() call if required,
-    // like closing the listening socket here or using non-blocking accept with timeout.
-    // For simplicity, this example relies on the g_running flag checked after accept returns.
-}
+// --- epoll mode ---
+//
+// Every event loop (reactor) owns an epoll instance and its own listening
+// socket bound to the same port with SO_REUSEPORT. The kernel spreads incoming
+// connections across the listeners by hashing the 4-tuple, so reactors never
+// contend for one accept queue, and each connection stays on the reactor that
+// accepted it for its whole life. Reactors are pinned to distinct CPUs.
+// Client sockets are non-blocking and edge-triggered: on each readiness event
+// the loop reads until EAGAIN, and replies that do not fit in the socket
+// buffer wait in the connection's output buffer until EPOLLOUT. Both buffers
+// borrow blocks from the loop's pool only while they hold data.
+//
+// A client that pipelines requests without reading the replies would make
+// that output buffer grow without bound, so a connection whose backlog
+// reaches the high watermark is paused: the loop stops reading it (and drops
+// EPOLLIN from its interest) until the backlog drains to the low watermark.
+// The same pause applies to every connection while the server as a whole is
+// over its memory budget.
+//
+// With --unix, every loop also watches the one shared Unix listener
+// (EPOLLEXCLUSIVE, so a new local client wakes a single loop); local
+// connections are then served exactly like TCP ones.
+//
+// Commands marked Offload (see commands.hpp) run on the compute pool. Their
+// replies come back through the loop's CompletionChannel, whose eventfd sits
+// in the epoll set beside the sockets, and join the output in request order.
 
-int main() {
-    int server_fd;
-    struct sockaddr_in server_addr;
+struct Connection {
+    explicit Connection(BufferPool* pool) : input(pool), output(pool) {}
 
-    // Register signal handler for SIGINT (Ctrl+C)
-    signal(SIGINT, signal_handler);
+    int fd = -1;
+    std::string peer;        // "ip:port", for logging
+    LineFramer input;        // Received bytes not yet forming a complete message
+    ByteBuffer output;       // Reply bytes not yet accepted by the kernel
+    uint32_t events = 0;     // epoll interest currently registered
+    bool paused = false;     // Not being read (backpressure)
+    bool starved = false;    // Paused with nothing to send, so only the budget check can resume it
+    bool half_closed = false; // The peer sent everything; kept open only to deliver the replies
+    size_t charged = 0;      // Bytes counted in g_buffered_bytes for this connection
+    ConnectionTimer timer;   // Idle and read timeouts
+    uint64_t id = 0;         // Unique within the loop, unlike fd, for matching completions
+    ReplyQueue replies;      // Replies waiting for an offloaded command ahead of them
+};
+
+struct EventLoop {
+    const ServerConfig* config = nullptr;
+    int epoll_fd = -1;
+    int server_fd = -1;
+    int local_fd = -1; // The Unix listener shared by all loops, or -1
+    uint64_t messages = 0;
+    BufferPool pool; // Declared before connections so that it outlives their buffers
+    // Connections owned by this loop, by descriptor. Only this loop's thread touches it.
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> starved;  // Descriptors of starved connections
+    std::vector<int> resuming; // Scratch space for retrying them
+    TimerWheel timers{current_tick()};
+    std::shared_ptr<CompletionChannel> channel; // Offloaded commands' replies; null without a pool
+    uint64_t next_id = 0;
+    std::string reply; // Scratch space for a command's output
+    StatsShard* stats = nullptr; // This loop thread's counters
+};
+
+bool set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
 
-    // 1. Create socket file descriptor
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+// Creates a socket listening on PORT. With reuse_port, several such sockets
+// can be bound at once and the kernel load-balances connections between them.
+// Returns -1 (after printing the error) on failure.
+int create_listener(int backlog, bool reuse_port) {
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (server_fd < 0) {
         std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
-        return 1;
+        return -1;
     }
 
     // Set socket options - Allow reuse of local addresses
@@ -104,39 +532,1592 @@ int main() {
     if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
         std::cerr << "Error setting socket options: " << strerror(errno) << std::endl;
         close(server_fd);
-        return 1;
+        return -1;
+    }
+    if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        std::cerr << "Error setting SO_REUSEPORT: " << strerror(errno) << std::endl;
+        close(server_fd);
+        return -1;
     }
-    // SO_REUSEPORT is also useful sometimes but SO_REUSEADDR is more common
-    // if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
-    //     perror("setsockopt(SO_REUSEPORT) failed");
-    // }
-
 
-    // 2. Prepare the sockaddr_in structure
+    // Prepare the sockaddr_in structure
+    struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;         // IPv4
     server_addr.sin_addr.s_addr = INADDR_ANY; // Listen on all available interfaces
     server_addr.sin_port = htons(PORT);     // Port number (host-to-network short)
 
-    // 3. Bind the socket to the address and port
+    // Bind the socket to the address and port
     if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         std::cerr << "Error binding socket: " << strerror(errno) << std::endl;
         close(server_fd);
-        return 1;
+        return -1;
     }
 
-    // 4. Listen for incoming connections
-    if (listen(server_fd, BACKLOG) < 0) {
+    // Listen for incoming connections
+    if (listen(server_fd, backlog) < 0) {
         std::cerr << "Error listening on socket: " << strerror(errno) << std::endl;
         close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+// CPUs this process is allowed to run on, in ascending order.
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// Pins the calling thread to one CPU. Failure only costs locality, so it is just logged.
+void pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        log_warn("cannot pin event loop", {{"cpu", cpu}, {"error", strerror(err)}});
+    }
+}
+
+std::string format_peer(const struct sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, ip, INET_ADDRSTRLEN);
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+// Unix socket clients have no address worth printing; name them by process.
+std::string format_local_peer(int fd) {
+    struct ucred cred{};
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) {
+        return "unix pid " + std::to_string(cred.pid);
+    }
+    return "unix";
+}
+
+// "ip:port" for TCP clients, "unix pid N" for local ones.
+std::string format_peer(const struct sockaddr_storage& addr, int fd) {
+    if (addr.ss_family == AF_INET) {
+        return format_peer(reinterpret_cast<const struct sockaddr_in&>(addr));
+    }
+    return format_local_peer(fd);
+}
+
+// Creates a Unix stream socket listening at path. A socket file left behind
+// by a server that died is replaced, but not one a live server still listens on.
+int create_unix_listener(const std::string& path, int backlog) {
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "Error creating Unix socket: " << strerror(errno) << std::endl;
+        return -1;
+    }
+    int bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    if (bound < 0 && errno == EADDRINUSE) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (!live) {
+            unlink(path.c_str());
+            bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+        } else {
+            errno = EADDRINUSE;
+        }
+    }
+    if (bound < 0 || listen(fd, backlog) < 0) {
+        std::cerr << "Error listening on " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Closes a Unix listener and removes its socket file.
+void close_unix_listener(int fd, const std::string& path) {
+    if (fd >= 0) {
+        close(fd);
+        unlink(path.c_str());
+    }
+}
+
+// Raises the open file limit to the hard limit; every connection is a descriptor.
+void raise_fd_limit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void close_connection(EventLoop& loop, Connection* conn) {
+    int fd = conn->fd;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    log_info("connection closed", {{"peer", conn->peer}});
+    charge_buffered(conn->charged, 0);
+    release_connection();
+    loop.timers.cancel(&conn->timer.node);
+    loop.connections.erase(fd); // Frees conn
+}
+
+// Registers the epoll events conn needs now: input unless it is paused,
+// output while a backlog remains.
+bool update_interest(EventLoop& loop, Connection* conn) {
+    uint32_t events = EPOLLET;
+    if (!conn->paused && !conn->half_closed) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (!conn->output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events == conn->events) {
+        return true;
+    }
+    struct epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = conn;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) < 0) {
+        return false;
+    }
+    conn->events = events;
+    return true;
+}
+
+// Reply bytes held for conn, sent or waiting behind an offloaded command.
+size_t pending_output(const Connection* conn) {
+    return conn->output.size() + conn->replies.size();
+}
+
+size_t buffered_bytes(const Connection* conn) {
+    return conn->input.buffered() + pending_output(conn);
+}
+
+// Sends as much pending output as the socket takes. Returns false on a fatal error.
+bool flush_output(EventLoop& loop, Connection* conn) {
+    while (!conn->output.empty()) {
+        ssize_t sent = send(conn->fd, conn->output.data(), conn->output.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            log_error("send failed", {{"peer", conn->peer}, {"error", strerror(errno)}});
+            loop.stats->count_send_error();
+            return false;
+        }
+        loop.stats->count_bytes_out(static_cast<size_t>(sent));
+        conn->output.consume(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Answers one message: echoes and hello through writer, commands inline or
+// on the compute pool. While an offloaded reply is outstanding, later
+// replies queue behind it in conn->replies. Returns false if a compute
+// pool job answers it instead.
+bool answer_message(EventLoop& loop, Connection* conn, ReplyWriter& writer, std::string_view message) {
+    std::string_view argument;
+    const Command* command = find_command(message, argument);
+    if (command == nullptr && conn->replies.idle()) {
+        writer.reply_to(message); // The fast path: no copy, no allocation
+        return true;
+    }
+    Dispatch how = offload_command(command, argument, loop.channel, conn->fd, conn->id, conn->replies);
+    if (how == Dispatch::Offloaded) {
+        return false;
+    }
+    loop.reply.clear();
+    run_inline(command, argument, message, how, loop.reply);
+    if (conn->replies.idle()) {
+        writer.reply_with(loop.reply); // A failure shows up again in the caller's flush()
+    } else {
+        conn->replies.add_ready(loop.reply);
+    }
+    return true;
+}
+
+// Reads everything available (edge-triggered) and answers every complete
+// message, each read's replies leaving in one sendmsg() where the socket allows.
+// Stops early, pausing the connection, once backpressure applies.
+// Returns false once the connection should be closed.
+bool handle_readable(EventLoop& loop, Connection* conn) {
+    std::string_view message;
+    while (true) {
+        if (pending_output(conn) >= loop.config->high_watermark || over_memory_budget(*loop.config)) {
+            conn->paused = true; // Unread data stays in the socket, pushing back on the client
+            break;
+        }
+        char* space = conn->input.prepare(RECV_MIN_SPACE);
+        ssize_t bytes_received = recv(conn->fd, space, conn->input.room(), 0);
+        if (bytes_received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->input.trim(); // Idle: give the receive block back if nothing is partial
+                break;
+            }
+            log_error("receive failed", {{"peer", conn->peer}, {"error", strerror(errno)}});
+            loop.stats->count_recv_error();
+            return false;
+        }
+        if (bytes_received == 0) {
+            log_info("client disconnected", {{"peer", conn->peer}});
+            conn->half_closed = true; // Stops reading; serve_connection() closes it once the replies are out
+            return true;
+        }
+
+        conn->input.commit(static_cast<size_t>(bytes_received));
+        loop.stats->count_bytes_in(static_cast<size_t>(bytes_received));
+        ReplyWriter replies(conn->fd, conn->output, *loop.stats);
+        while (conn->input.next(message)) {
+            log_sampled(LogLevel::Info, "received", {{"peer", conn->peer}, {"message", message}});
+            loop.stats->count_message_in();
+            uint64_t started = loop.stats->start_handler();
+            if (answer_message(loop, conn, replies, message)) {
+                loop.stats->count_answer(started);
+            }
+            ++loop.messages;
+        }
+        if (conn->input.overflowed()) {
+            log_error("message too long", {{"peer", conn->peer}, {"limit", MAX_MESSAGE_SIZE}});
+            return false;
+        }
+        if (!replies.flush()) {
+            log_error("send failed", {{"peer", conn->peer}, {"error", strerror(errno)}});
+            loop.stats->count_send_error();
+            return false;
+        }
+        charge_buffered(conn->charged, buffered_bytes(conn));
+    }
+    return true;
+}
+
+// Does whatever conn is ready for: reads (if readable and not paused),
+// sends its backlog, and resumes reading once backpressure has eased.
+// Returns false once the connection should be closed.
+bool serve_connection(EventLoop& loop, Connection* conn, bool readable) {
+    while (true) {
+        if (readable && !conn->paused && !conn->half_closed && !handle_readable(loop, conn)) {
+            return false;
+        }
+        if (!flush_output(loop, conn)) {
+            return false;
+        }
+        if (conn->half_closed && conn->replies.idle() && conn->output.empty()) {
+            return false; // The last reply went out; a client that stops reading meets the idle timeout
+        }
+        if (!conn->paused || pending_output(conn) > loop.config->low_watermark || over_memory_budget(*loop.config)) {
+            break;
+        }
+        conn->paused = false; // Drained: read what the client sent meanwhile
+        readable = true;
+    }
+    charge_buffered(conn->charged, buffered_bytes(conn));
+    // A half-closed connection's partial message can never complete; only the idle timeout applies
+    touch_timer(loop.timers, conn->timer, *loop.config, !conn->half_closed && conn->input.unterminated() > 0);
+    if (conn->paused && conn->output.empty() && !conn->starved) {
+        conn->starved = true; // No EPOLLOUT will come; the loop retries it when the budget allows
+        loop.starved.push_back(conn->fd);
+    }
+    return update_interest(loop, conn); // Watches for EPOLLOUT while a backlog remains
+}
+
+// Retries the starved connections once the server is back under its memory budget.
+void resume_starved(EventLoop& loop) {
+    if (loop.starved.empty() || over_memory_budget(*loop.config)) {
+        return;
+    }
+    loop.resuming.swap(loop.starved);
+    for (int fd : loop.resuming) {
+        auto it = loop.connections.find(fd);
+        if (it == loop.connections.end() || !it->second->starved) {
+            continue; // Closed meanwhile (and the descriptor perhaps reused)
+        }
+        Connection* conn = it->second.get();
+        conn->starved = false;
+        if (!serve_connection(loop, conn, false)) {
+            close_connection(loop, conn);
+        }
+    }
+    loop.resuming.clear();
+}
+
+// Moves the replies of finished offloaded commands into their connections'
+// output, in request order, and sends them.
+void handle_completions(EventLoop& loop) {
+    loop.channel->drain([&loop](Completion& done) {
+        auto it = loop.connections.find(done.fd);
+        if (it == loop.connections.end() || it->second->id != done.connection) {
+            return; // The connection closed while its command ran
+        }
+        Connection* conn = it->second.get();
+        conn->replies.complete(done.seq, std::move(done.reply));
+        conn->replies.release([conn](std::string_view reply) { conn->output.append(reply.data(), reply.size()); });
+        if (!serve_connection(loop, conn, false)) {
+            close_connection(loop, conn);
+        }
+    });
+}
+
+// Accepts every pending connection on a (non-blocking) listening socket of this loop.
+// accept4 returns the client socket already non-blocking, saving two fcntl calls each.
+void accept_connections(EventLoop& loop, int listen_fd) {
+    while (true) {
+        struct sockaddr_storage client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        int client_socket = accept4(listen_fd, (struct sockaddr*)&client_addr, &client_addr_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue; // ECONNABORTED: the client gave up while queued, try the next one
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("accept failed", {{"error", strerror(errno)}});
+            }
+            return; // EAGAIN: accept queue drained
+        }
+
+        if (!admit_connection(*loop.config)) {
+            log_warn("connection limit reached", {{"limit", loop.config->max_connections}});
+            close(client_socket);
+            continue;
+        }
+
+        auto conn = std::make_unique<Connection>(&loop.pool);
+        conn->fd = client_socket;
+        conn->id = ++loop.next_id;
+        conn->peer = format_peer(client_addr, client_socket);
+
+        struct epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            log_error("cannot register client socket", {{"peer", conn->peer}, {"error", strerror(errno)}});
+            close(client_socket);
+            release_connection();
+            continue;
+        }
+        conn->events = ev.events;
+        conn->timer.node.owner = conn.get();
+        touch_timer(loop.timers, conn->timer, *loop.config, false);
+        log_info("connection accepted", {{"peer", conn->peer}});
+        loop.connections.emplace(client_socket, std::move(conn));
+    }
+}
+
+// Runs one reactor on its own listening socket until shutdown; closes server_fd on exit.
+void run_event_loop(const ServerConfig& config, int server_fd, int local_fd, int cpu) {
+    if (cpu >= 0) {
+        pin_current_thread(cpu);
+    }
+
+    EventLoop loop;
+    loop.config = &config;
+    loop.server_fd = server_fd;
+    loop.local_fd = local_fd;
+    loop.stats = &ServerStats::instance().shard();
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd < 0) {
+        log_error("cannot create epoll instance", {{"error", strerror(errno)}});
+        close(server_fd);
+        return;
+    }
+
+    // The listener is tagged with a null pointer; connections carry their Connection*.
+    struct epoll_event listen_ev{};
+    listen_ev.events = EPOLLIN;
+    listen_ev.data.ptr = nullptr;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, server_fd, &listen_ev) < 0) {
+        log_error("cannot register listening socket", {{"error", strerror(errno)}});
+        close(loop.epoll_fd);
+        close(server_fd);
+        return;
+    }
+
+    // The Unix listener is tagged with the address of loop.local_fd.
+    if (local_fd >= 0) {
+        struct epoll_event local_ev{};
+        local_ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        local_ev.data.ptr = &loop.local_fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, local_fd, &local_ev) < 0) {
+            log_error("cannot register Unix listener", {{"error", strerror(errno)}});
+        }
+    }
+
+    // The completion channel is tagged with its own address.
+    if (g_compute_pool != nullptr) {
+        loop.channel = std::make_shared<CompletionChannel>(MAX_JOBS_PER_REACTOR);
+        struct epoll_event wake_ev{};
+        wake_ev.events = EPOLLIN;
+        wake_ev.data.ptr = loop.channel.get();
+        if (!loop.channel->valid() || epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.channel->fd(), &wake_ev) < 0) {
+            log_warn("cannot watch completion channel; running commands inline", {{"error", strerror(errno)}});
+            loop.channel.reset();
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (g_running) {
+        int count = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error("epoll_wait failed", {{"error", strerror(errno)}});
+            break;
+        }
+
+        bool woken = false; // The completion channel has replies
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                accept_connections(loop, loop.server_fd);
+                continue;
+            }
+            if (events[i].data.ptr == &loop.local_fd) {
+                accept_connections(loop, loop.local_fd);
+                continue;
+            }
+            if (loop.channel && events[i].data.ptr == loop.channel.get()) {
+                woken = true; // Handled after the batch: it may close connections with events below
+                continue;
+            }
+            auto* conn = static_cast<Connection*>(events[i].data.ptr);
+
+            uint32_t flags = events[i].events;
+            // recv() reports the orderly shutdown behind EPOLLRDHUP
+            bool keep = !(flags & (EPOLLERR | EPOLLHUP)) &&
+                        serve_connection(loop, conn, (flags & (EPOLLIN | EPOLLRDHUP)) != 0);
+            if (!keep) {
+                close_connection(loop, conn);
+            }
+        }
+        if (woken) {
+            handle_completions(loop);
+        }
+        resume_starved(loop); // At most EPOLL_TIMEOUT_MS after the budget frees up
+
+        // Close every connection whose deadline passed, all in one sweep.
+        loop.timers.advance(current_tick(), [&loop](TimerNode* node) {
+            auto* conn = static_cast<Connection*>(node->owner);
+            if (timer_expired(loop.timers, conn->timer)) {
+                log_timeout(conn->peer, conn->timer);
+                close_connection(loop, conn);
+            }
+        });
+    }
+
+    // Cleanup: close the connections this loop still owns.
+    for (auto& entry : loop.connections) {
+        close(entry.first);
+        charge_buffered(entry.second->charged, 0);
+        release_connection();
+    }
+    loop.connections.clear();
+    close(loop.epoll_fd);
+    close(server_fd);
+    g_messages_served.fetch_add(loop.messages, std::memory_order_relaxed);
+}
+
+// --- io_uring mode ---
+//
+// Same reactor layout as epoll mode (one SO_REUSEPORT listener per pinned
+// thread), but each reactor drives an io_uring instead of an epoll set:
+//   * one multishot accept per listener (and on the shared Unix listener)
+//     keeps producing new connections;
+//   * one multishot recv per connection keeps producing data, each chunk
+//     landing in a buffer the kernel picks from the reactor's provided buffer
+//     ring and copied straight into the connection's framer;
+//   * replies produced by one batch of completions go out as one send per
+//     connection (at most one in flight, so bytes stay in order);
+//   * a connection the peer closed gets its last send linked to its close;
+//   * a multishot poll on the completion channel's eventfd reports replies
+//     of offloaded commands, as in epoll mode.
+// All of that is submitted, and the next completions reaped, with a single
+// io_uring_enter per loop iteration, so under load the per-message system
+// call count approaches zero.
+
+constexpr unsigned URING_ENTRIES = 4096;        // Submission queue size per reactor
+constexpr unsigned URING_CQ_ENTRIES = 16384;    // Completion queue size per reactor
+constexpr unsigned URING_BUFFERS = 4096;        // Provided receive buffers per reactor (power of two)
+constexpr unsigned URING_BUFFER_SIZE = 4096;    // Bytes per provided buffer
+constexpr unsigned short URING_BUFFER_GROUP = 0;
+
+// Operation kind, kept in the low bits of user_data next to the (8-byte aligned) connection pointer.
+enum UringOp : uint64_t {
+    URING_ACCEPT = 0,
+    URING_RECV = 1,
+    URING_SEND = 2,
+    URING_CLOSE = 3,
+    URING_CANCEL = 4,
+    URING_WAKE = 5, // The completion channel became readable
+    URING_ACCEPT_LOCAL = 6, // Accepts on the Unix listener
+    URING_OP_MASK = 7
+};
+
+struct UringConnection {
+    explicit UringConnection(BufferPool* pool) : input(pool) {}
+
+    int fd = -1;
+    std::string peer;           // "ip:port", for logging
+    LineFramer input;           // Received bytes not yet forming a complete message
+    std::string pending;        // Replies not yet handed to the kernel
+    std::string sending;        // Bytes owned by the send in flight
+    bool recv_armed = false;    // Multishot recv still active
+    bool send_inflight = false;
+    bool closing = false;       // No new work; closed once nothing is in flight
+    bool flush_on_close = false; // Peer closed cleanly: send what is pending before closing
+    bool close_submitted = false; // Or closed already, if no submission slot was free
+    bool queued_for_flush = false;
+    bool paused = false;        // Recv cancelled or not re-armed (backpressure)
+    bool starved = false;       // Paused with nothing to send, so only the budget check can resume it
+    size_t charged = 0;         // Bytes counted in g_buffered_bytes for this connection
+    ConnectionTimer timer;      // Idle and read timeouts
+    uint64_t id = 0;            // Unique within the loop, unlike fd, for matching completions
+    ReplyQueue replies;         // Replies waiting for an offloaded command ahead of them
+};
+
+struct UringLoop {
+    const ServerConfig* config = nullptr;
+    UringRing ring;
+    BufferRing buffers;
+    int server_fd = -1;
+    int local_fd = -1; // The Unix listener shared by all loops, or -1
+    uint64_t messages = 0;
+    BufferPool pool; // Declared before connections so that it outlives their framers
+    std::unordered_map<int, std::unique_ptr<UringConnection>> connections;
+    std::vector<UringConnection*> to_flush; // Connections with new replies in this batch
+    std::vector<std::unique_ptr<UringConnection>> closed; // Freed after the batch, which may still point at them
+    std::vector<int> starved;  // Descriptors of starved connections
+    std::vector<int> resuming; // Scratch space for retrying them
+    TimerWheel timers{current_tick()};
+    std::shared_ptr<CompletionChannel> channel; // Offloaded commands' replies; null without a pool
+    bool wake_armed = false; // The multishot poll on the channel is active
+    bool woken = false;      // It fired in this batch
+    uint64_t next_id = 0;
+    std::string reply; // Scratch space for a command's output
+    StatsShard* stats = nullptr; // This loop thread's counters
+};
+
+uint64_t uring_tag(UringConnection* conn, UringOp op) {
+    return reinterpret_cast<uint64_t>(conn) | op;
+}
+
+// Starts a multishot accept on the TCP listener (op URING_ACCEPT) or the Unix one (URING_ACCEPT_LOCAL).
+void uring_arm_accept(UringLoop& loop, UringOp op) {
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    if (sqe == nullptr) {
+        log_error("cannot queue accept", {{"error", "submission queue full"}});
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = op == URING_ACCEPT_LOCAL ? loop.local_fd : loop.server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = uring_tag(nullptr, op);
+}
+
+bool uring_arm_wake(UringLoop& loop) {
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = loop.channel->fd();
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = uring_tag(nullptr, URING_WAKE);
+    loop.wake_armed = true;
+    return true;
+}
+
+bool uring_arm_recv(UringLoop& loop, UringConnection* conn) {
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = loop.buffers.group();
+    sqe->user_data = uring_tag(conn, URING_RECV);
+    conn->recv_armed = true;
+    return true;
+}
+
+// Queues a send of everything pending. With link, the next queued entry
+// (the close) only runs after it, whether or not the send succeeds.
+bool uring_send_pending(UringLoop& loop, UringConnection* conn, bool link) {
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    conn->sending.swap(conn->pending);
+    conn->pending.clear();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn->sending.data());
+    sqe->len = static_cast<uint32_t>(conn->sending.size());
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL; // The kernel retries short sends itself
+    sqe->flags = link ? IOSQE_IO_HARDLINK : 0;
+    sqe->user_data = uring_tag(conn, URING_SEND);
+    conn->send_inflight = true;
+    return true;
+}
+
+void uring_free_connection(UringLoop& loop, UringConnection* conn) {
+    log_info("connection closed", {{"peer", conn->peer}});
+    charge_buffered(conn->charged, 0);
+    release_connection();
+    loop.timers.cancel(&conn->timer.node);
+    // Closed connections stay allocated until the batch is over: one may
+    // close inline (out of submission slots) after it was queued in to_flush.
+    auto it = loop.connections.find(conn->fd);
+    loop.closed.push_back(std::move(it->second));
+    loop.connections.erase(it);
+}
+
+size_t uring_output_size(const UringConnection* conn) {
+    return conn->pending.size() + conn->sending.size() + conn->replies.size();
+}
+
+// Asks the kernel to end conn's operation op (a multishot recv's final
+// completion then arrives without F_MORE, a send's with -ECANCELED).
+bool uring_cancel(UringLoop& loop, UringConnection* conn, UringOp op) {
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = uring_tag(conn, op);
+    sqe->user_data = uring_tag(nullptr, URING_CANCEL);
+    return true;
+}
+
+// Closes conn once no operation that references it is still in flight
+// (and, when flushing, no offloaded reply is still being computed and no
+// request is left unanswered behind the watermark).
+void uring_maybe_close(UringLoop& loop, UringConnection* conn) {
+    if (!conn->closing || conn->recv_armed || conn->send_inflight || conn->close_submitted ||
+        (conn->flush_on_close && !conn->replies.idle())) {
+        return;
+    }
+    if (conn->flush_on_close && conn->input.has_message()) {
+        // Answering stopped at the watermark, with the replies so far pending:
+        // send them on their own; the completion answers more requests (see
+        // uring_on_send) and calls this function again
+        if (!conn->pending.empty() && uring_send_pending(loop, conn, false)) {
+            return;
+        }
+        log_error("cannot queue send", {{"peer", conn->peer}});
+        conn->flush_on_close = false; // Out of submission slots: close without the rest
+    }
+    bool linked_send = conn->flush_on_close && !conn->pending.empty();
+    // A send and the close linked to it must go out in the same submission:
+    // split across two, the close would not wait for the send.
+    if (!loop.ring.reserve(linked_send ? 2 : 1)) {
+        if (linked_send && uring_send_pending(loop, conn, false)) {
+            return; // The lone send completes and this function runs again
+        }
+        close(conn->fd); // Out of submission slots: close it the ordinary way
+        conn->close_submitted = true; // Callers later in this batch may still call this function
+        uring_free_connection(loop, conn);
+        return;
+    }
+    if (linked_send) {
+        uring_send_pending(loop, conn, true);
+    }
+    struct io_uring_sqe* sqe = loop.ring.get_sqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = conn->fd;
+    sqe->user_data = uring_tag(conn, URING_CLOSE);
+    conn->close_submitted = true;
+}
+
+// Stops all work on conn: cancels its recv and closes it when nothing is in flight.
+void uring_begin_close(UringLoop& loop, UringConnection* conn, bool flush) {
+    if (conn->closing) {
+        return;
+    }
+    conn->closing = true;
+    conn->flush_on_close = flush;
+    loop.timers.cancel(&conn->timer.node);
+    bool cancelled = !conn->recv_armed || uring_cancel(loop, conn, URING_RECV);
+    if (conn->send_inflight && !flush) {
+        // A send to a client that stopped reading would never complete
+        cancelled = uring_cancel(loop, conn, URING_SEND) && cancelled;
+    }
+    if (!cancelled) {
+        shutdown(conn->fd, SHUT_RDWR); // Ends the operations with errors or zero-length completions instead
+    }
+    uring_maybe_close(loop, conn);
+}
+
+// Updates conn's share of the memory budget and pauses or resumes its recv
+// around the watermarks. The kernel may fill many provided buffers before
+// the cancel takes effect; those bytes wait unanswered in the input buffer
+// (see uring_handle_messages), so output stays near the watermark.
+void uring_apply_backpressure(UringLoop& loop, UringConnection* conn) {
+    charge_buffered(conn->charged, conn->input.buffered() + uring_output_size(conn));
+    if (conn->closing) {
+        return;
+    }
+    const ServerConfig& config = *loop.config;
+    size_t output = uring_output_size(conn);
+    if (!conn->paused) {
+        if (output >= config.high_watermark || over_memory_budget(config)) {
+            conn->paused = true;
+            if (conn->recv_armed) {
+                uring_cancel(loop, conn, URING_RECV); // If the queue is full, the next completion tries again
+            }
+        }
+    } else if (output <= config.low_watermark && !over_memory_budget(config)) {
+        conn->paused = false;
+        if (!conn->recv_armed && !uring_arm_recv(loop, conn)) {
+            uring_begin_close(loop, conn, false);
+            return;
+        }
+    }
+    if (conn->paused && output == 0 && !conn->starved) {
+        conn->starved = true; // No send completion will come; the loop retries it when the budget allows
+        loop.starved.push_back(conn->fd);
+    }
+}
+
+void uring_on_accept(UringLoop& loop, const struct io_uring_cqe& cqe, UringOp op) {
+    if (cqe.res < 0) {
+        if (cqe.res != -ECANCELED) {
+            log_error("accept failed", {{"error", strerror(-cqe.res)}});
+        }
+    } else if (!admit_connection(*loop.config)) {
+        log_warn("connection limit reached", {{"limit", loop.config->max_connections}});
+        close(cqe.res);
+    } else {
+        auto conn = std::make_unique<UringConnection>(&loop.pool);
+        conn->fd = cqe.res;
+        conn->id = ++loop.next_id;
+        struct sockaddr_storage client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        if (getpeername(conn->fd, (struct sockaddr*)&client_addr, &client_addr_len) == 0) {
+            conn->peer = format_peer(client_addr, conn->fd);
+        } else {
+            conn->peer = "fd " + std::to_string(conn->fd);
+        }
+        log_info("connection accepted", {{"peer", conn->peer}});
+        UringConnection* raw = conn.get();
+        raw->timer.node.owner = raw;
+        touch_timer(loop.timers, raw->timer, *loop.config, false);
+        loop.connections.emplace(raw->fd, std::move(conn));
+        if (!uring_arm_recv(loop, raw)) {
+            log_error("cannot queue receive", {{"peer", raw->peer}});
+            uring_begin_close(loop, raw, false);
+        }
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE) && g_running) {
+        uring_arm_accept(loop, op); // The multishot accept ended (e.g. an error); start a new one
+    }
+}
+
+// Answers one message, appending to conn->pending unless an offloaded reply
+// is outstanding; then the reply queues behind it in conn->replies.
+// Returns false if a compute pool job answers it instead.
+bool uring_answer_message(UringLoop& loop, UringConnection* conn, std::string_view message) {
+    std::string_view argument;
+    const Command* command = find_command(message, argument);
+    Dispatch how = offload_command(command, argument, loop.channel, conn->fd, conn->id, conn->replies);
+    if (how == Dispatch::Offloaded) {
+        return false;
+    }
+    if (conn->replies.idle()) {
+        run_inline(command, argument, message, how, conn->pending);
+        return true;
+    }
+    loop.reply.clear();
+    run_inline(command, argument, message, how, loop.reply);
+    conn->replies.add_ready(loop.reply);
+    return true;
+}
+
+// Answers the complete messages received so far, the replies going out with
+// the next batch flush. Stops at the high watermark: the rest waits in the
+// input buffer until sends complete.
+void uring_handle_messages(UringLoop& loop, UringConnection* conn) {
+    std::string_view message;
+    bool replied = false;
+    while (uring_output_size(conn) < loop.config->high_watermark && conn->input.next(message)) {
+        log_sampled(LogLevel::Info, "received", {{"peer", conn->peer}, {"message", message}});
+        loop.stats->count_message_in();
+        uint64_t started = loop.stats->start_handler();
+        if (uring_answer_message(loop, conn, message)) {
+            loop.stats->count_answer(started);
+        }
+        ++loop.messages;
+        replied = true;
+    }
+    conn->input.trim();
+    if (conn->input.overflowed()) {
+        log_error("message too long", {{"peer", conn->peer}, {"limit", MAX_MESSAGE_SIZE}});
+        uring_begin_close(loop, conn, false);
+        return;
+    }
+    if (replied && !conn->queued_for_flush) {
+        conn->queued_for_flush = true;
+        loop.to_flush.push_back(conn);
+    }
+    uring_apply_backpressure(loop, conn);
+}
+
+void uring_on_recv(UringLoop& loop, UringConnection* conn, const struct io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = false;
+    }
+
+    if (cqe.res > 0) {
+        auto bid = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        loop.stats->count_bytes_in(static_cast<size_t>(cqe.res));
+        if (!conn->closing) {
+            conn->input.append(loop.buffers.buffer(bid), static_cast<size_t>(cqe.res));
+            uring_handle_messages(loop, conn);
+            if (!conn->closing) {
+                touch_timer(loop.timers, conn->timer, *loop.config, conn->input.unterminated() > 0);
+            }
+        }
+        loop.buffers.recycle(bid);
+    } else if (cqe.res == 0) {
+        log_info("client disconnected", {{"peer", conn->peer}});
+        uring_begin_close(loop, conn, true);
+    } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+        log_error("receive failed", {{"peer", conn->peer}, {"error", strerror(-cqe.res)}});
+        loop.stats->count_recv_error();
+        uring_begin_close(loop, conn, false);
+    }
+
+    if (!conn->recv_armed && !conn->closing && !conn->paused) {
+        // Multishot recv stops when the buffer ring runs dry (-ENOBUFS) or on
+        // some partial results; buffers are recycled above, so just re-arm.
+        if (!uring_arm_recv(loop, conn)) {
+            uring_begin_close(loop, conn, false);
+        }
+    }
+    uring_maybe_close(loop, conn);
+}
+
+void uring_on_send(UringLoop& loop, UringConnection* conn, const struct io_uring_cqe& cqe) {
+    conn->send_inflight = false;
+    if (conn->close_submitted) {
+        return; // The final linked send; the close completion frees the connection
+    }
+    if (cqe.res < 0) {
+        if (cqe.res != -ECANCELED) {
+            log_error("send failed", {{"peer", conn->peer}, {"error", strerror(-cqe.res)}});
+            loop.stats->count_send_error();
+        }
+        conn->pending.clear();
+        uring_begin_close(loop, conn, false);
+        uring_maybe_close(loop, conn); // Already closing if this send was cancelled
+        return;
+    }
+    size_t sent = static_cast<size_t>(cqe.res);
+    loop.stats->count_bytes_out(sent);
+    if (sent < conn->sending.size()) {
+        // Short send despite MSG_WAITALL: put the rest back in front of the newer replies.
+        conn->pending.insert(0, conn->sending, sent, std::string::npos);
+    }
+    conn->sending.clear();
+    if (!conn->closing) {
+        touch_timer(loop.timers, conn->timer, *loop.config, conn->input.unterminated() > 0);
+    }
+    if (!conn->closing || conn->flush_on_close) {
+        // Answers what waited behind the watermark; updates backpressure. After a
+        // clean close the requests already received are still answered, and
+        // uring_maybe_close() sends them.
+        uring_handle_messages(loop, conn);
+    }
+    if (!conn->pending.empty() && !conn->closing) {
+        if (!uring_send_pending(loop, conn, false)) {
+            uring_begin_close(loop, conn, false);
+        }
+    }
+    uring_maybe_close(loop, conn);
+}
+
+// Moves the replies of finished offloaded commands into their connections'
+// pending output, in request order; they leave with this batch's sends.
+void uring_handle_completions(UringLoop& loop) {
+    loop.channel->drain([&loop](Completion& done) {
+        auto it = loop.connections.find(done.fd);
+        if (it == loop.connections.end() || it->second->id != done.connection) {
+            return; // The connection closed while its command ran
+        }
+        UringConnection* conn = it->second.get();
+        conn->replies.complete(done.seq, std::move(done.reply));
+        conn->replies.release([conn](std::string_view reply) { conn->pending.append(reply.data(), reply.size()); });
+        if (conn->closing) {
+            uring_maybe_close(loop, conn); // Sends the replies last if it waited for them
+            return;
+        }
+        if (!conn->queued_for_flush) {
+            conn->queued_for_flush = true;
+            loop.to_flush.push_back(conn);
+        }
+        uring_apply_backpressure(loop, conn);
+    });
+}
+
+// Retries the starved connections once the server is back under its memory budget.
+void uring_resume_starved(UringLoop& loop) {
+    if (loop.starved.empty() || over_memory_budget(*loop.config)) {
+        return;
+    }
+    loop.resuming.swap(loop.starved);
+    for (int fd : loop.resuming) {
+        auto it = loop.connections.find(fd);
+        if (it == loop.connections.end() || !it->second->starved) {
+            continue; // Closed meanwhile (and the descriptor perhaps reused)
+        }
+        it->second->starved = false;
+        uring_apply_backpressure(loop, it->second.get());
+    }
+    loop.resuming.clear();
+}
+
+void uring_handle_completion(UringLoop& loop, const struct io_uring_cqe& cqe) {
+    auto op = static_cast<UringOp>(cqe.user_data & URING_OP_MASK);
+    auto* conn = reinterpret_cast<UringConnection*>(cqe.user_data & ~static_cast<uint64_t>(URING_OP_MASK));
+    switch (op) {
+    case URING_ACCEPT:
+    case URING_ACCEPT_LOCAL:
+        uring_on_accept(loop, cqe, op);
+        break;
+    case URING_RECV:
+        uring_on_recv(loop, conn, cqe);
+        break;
+    case URING_SEND:
+        uring_on_send(loop, conn, cqe);
+        break;
+    case URING_CLOSE:
+        uring_free_connection(loop, conn);
+        break;
+    case URING_WAKE:
+        loop.woken = true; // Drained after the batch
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            loop.wake_armed = false; // Re-armed by the loop
+        }
+        break;
+    default:
+        break; // Cancel requests report nothing we need
+    }
+}
+
+// Runs one io_uring reactor on its own listening socket until shutdown; closes server_fd on exit.
+void run_uring_loop(const ServerConfig& config, int server_fd, int local_fd, int cpu) {
+    if (cpu >= 0) {
+        pin_current_thread(cpu);
+    }
+
+    {
+        UringLoop loop;
+        loop.config = &config;
+        loop.server_fd = server_fd;
+        loop.local_fd = local_fd;
+        loop.stats = &ServerStats::instance().shard();
+        int err = loop.ring.init(URING_ENTRIES, URING_CQ_ENTRIES);
+        if (err == 0) {
+            err = loop.buffers.init(loop.ring, URING_BUFFER_GROUP, URING_BUFFERS, URING_BUFFER_SIZE);
+        }
+        if (err != 0) {
+            log_error("cannot set up io_uring reactor", {{"error", strerror(-err)}});
+            close(server_fd);
+            return;
+        }
+
+        if (g_compute_pool != nullptr) {
+            loop.channel = std::make_shared<CompletionChannel>(MAX_JOBS_PER_REACTOR);
+            if (!loop.channel->valid()) {
+                log_warn("cannot create completion channel; running commands inline", {{"error", strerror(errno)}});
+                loop.channel.reset();
+            }
+        }
+
+        uring_arm_accept(loop, URING_ACCEPT);
+        if (local_fd >= 0) {
+            uring_arm_accept(loop, URING_ACCEPT_LOCAL);
+        }
+        while (g_running) {
+            if (loop.channel && !loop.wake_armed) {
+                uring_arm_wake(loop);
+            }
+            int ret = loop.ring.submit_and_wait(1, EPOLL_TIMEOUT_MS);
+            if (ret < 0 && ret != -EBUSY) {
+                log_error("io_uring_enter failed", {{"error", strerror(-ret)}});
+                break;
+            }
+            loop.ring.for_each_cqe([&loop](const struct io_uring_cqe& cqe) {
+                uring_handle_completion(loop, cqe);
+            });
+            if (loop.woken) {
+                loop.woken = false;
+                uring_handle_completions(loop);
+            }
+
+            // One send per connection for everything this batch produced.
+            for (UringConnection* conn : loop.to_flush) {
+                conn->queued_for_flush = false;
+                if (!conn->send_inflight && !conn->closing && !conn->pending.empty()) {
+                    if (!uring_send_pending(loop, conn, false)) {
+                        uring_begin_close(loop, conn, false);
+                    }
+                }
+            }
+            loop.to_flush.clear();
+            uring_resume_starved(loop); // At most EPOLL_TIMEOUT_MS after the budget frees up
+
+            // Start closing every connection whose deadline passed, all in one sweep.
+            loop.timers.advance(current_tick(), [&loop](TimerNode* node) {
+                auto* conn = static_cast<UringConnection*>(node->owner);
+                if (timer_expired(loop.timers, conn->timer)) {
+                    log_timeout(conn->peer, conn->timer);
+                    uring_begin_close(loop, conn, false);
+                }
+            });
+            loop.closed.clear();
+        }
+
+        // Tear the ring down first so that the kernel is done with every
+        // buffer before the connections owning them are freed.
+        loop.buffers.destroy();
+        loop.ring.destroy();
+        for (auto& entry : loop.connections) {
+            close(entry.first);
+            charge_buffered(entry.second->charged, 0);
+            release_connection();
+        }
+        loop.connections.clear();
+        loop.closed.clear();
+        g_messages_served.fetch_add(loop.messages, std::memory_order_relaxed);
+    }
+    close(server_fd);
+}
+
+// Checks that this kernel has everything the io_uring reactor uses. On
+// failure, stores the reason in why and returns false.
+bool uring_supported(std::string& why) {
+    UringRing ring;
+    int err = ring.init(8, 16);
+    if (err != 0) {
+        why = std::string("io_uring_setup failed: ") + strerror(-err);
+        return false;
+    }
+    constexpr unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_FAST_POLL;
+    if ((ring.features() & required) != required) {
+        why = "kernel lacks io_uring features (needs 5.11 or newer)";
+        return false;
+    }
+    if (!ring.supports_ops({IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_CLOSE,
+                            IORING_OP_ASYNC_CANCEL, IORING_OP_POLL_ADD})) {
+        why = "kernel lacks io_uring accept/recv/send/close/poll opcodes";
+        return false;
+    }
+    BufferRing buffers;
+    err = buffers.init(ring, URING_BUFFER_GROUP, 8, 64);
+    if (err != 0) {
+        why = std::string("provided buffer rings unsupported (needs 5.19 or newer): ") + strerror(-err);
+        return false;
+    }
+
+    // Multishot recv (6.0) cannot be probed as an opcode: try it on a socket pair.
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        why = std::string("socketpair failed: ") + strerror(errno);
+        return false;
+    }
+    struct io_uring_sqe* sqe = ring.get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = pair[0];
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    bool multishot = false;
+    if (send(pair[1], "x", 1, MSG_NOSIGNAL) == 1 && ring.submit_and_wait(1, 1000) >= 0) {
+        ring.for_each_cqe([&multishot](const struct io_uring_cqe& cqe) {
+            multishot = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+        });
+    }
+    close(pair[0]);
+    close(pair[1]);
+    if (!multishot) {
+        why = "multishot recv unsupported (needs 6.0 or newer)";
+        return false;
+    }
+    return true;
+}
+
+// --- reactor threads (epoll and io_uring modes) ---
+
+// Runs config.threads copies of reactor, each on its own SO_REUSEPORT
+// listener and all on the Unix listener if there is one (the calling thread
+// is reactor 0), until shutdown.
+// Returns false if the listening sockets could not be set up.
+bool run_reactors(const ServerConfig& config,
+                  void (*reactor)(const ServerConfig& config, int server_fd, int local_fd, int cpu),
+                  const char* backend) {
+    raise_fd_limit();
+
+    // SO_REUSEPORT would let this server silently share the port with another
+    // instance of itself, so first check that the port is free with a plain bind.
+    int probe_fd = create_listener(1, false);
+    if (probe_fd < 0) {
+        return false;
+    }
+    close(probe_fd);
+
+    // Bind every listener up front so that a failure stops startup
+    // instead of leaving a reactor short.
+    std::vector<int> listeners;
+    for (int i = 0; i < config.threads; ++i) {
+        int server_fd = create_listener(config.backlog, true);
+        if (server_fd < 0 || !set_non_blocking(server_fd)) {
+            if (server_fd >= 0) {
+                std::cerr << "Error making listening socket non-blocking: " << strerror(errno) << std::endl;
+                close(server_fd);
+            }
+            for (int fd : listeners) {
+                close(fd);
+            }
+            return false;
+        }
+        listeners.push_back(server_fd);
+    }
+    int local_fd = -1;
+    if (!config.unix_path.empty()) {
+        local_fd = create_unix_listener(config.unix_path, config.backlog);
+        if (local_fd < 0 || !set_non_blocking(local_fd)) {
+            close_unix_listener(local_fd, config.unix_path);
+            for (int fd : listeners) {
+                close(fd);
+            }
+            return false;
+        }
+    }
+
+    std::vector<int> cpus;
+    if (config.pin_threads) {
+        cpus = allowed_cpus();
+    }
+    auto cpu_for = [&cpus](int reactor) {
+        return cpus.empty() ? -1 : cpus[static_cast<size_t>(reactor) % cpus.size()];
+    };
+
+    std::cout << "Server listening on port " << PORT << " with " << config.threads << " " << backend
+              << " SO_REUSEPORT reactor(s)" << (cpus.empty() ? "" : ", pinned to CPUs")
+              << (local_fd >= 0 ? " and on " + config.unix_path : std::string()) << "..." << std::endl;
+
+    std::vector<std::thread> loops;
+    for (int i = 1; i < config.threads; ++i) {
+        loops.emplace_back(reactor, std::cref(config), listeners[static_cast<size_t>(i)], local_fd, cpu_for(i));
+    }
+    reactor(config, listeners[0], local_fd, cpu_for(0));
+    for (std::thread& t : loops) {
+        t.join();
+    }
+    close_unix_listener(local_fd, config.unix_path);
+    return true;
+}
+
+// --- Unix socket and shared-memory clients ---
+//
+// With --shm, a client connects to a Unix socket and hands over a sealed
+// memfd holding two single-producer rings plus two eventfds (shm_ring.hpp);
+// from then on messages and replies travel through the rings, framed by
+// newlines as on a socket, and no system call is needed while both sides
+// keep busy. Each such client gets a thread of its own that polls its ring
+// for a moment after the last message before it sleeps on its eventfd. The
+// socket stays open only to notice the client going away.
+
+// Serves one shared-memory client on the accepted socket sock until it leaves.
+void handle_shm_client(int sock, int idle_timeout, size_t high_watermark) {
+    std::string peer = format_local_peer(sock);
+    struct timeval handshake{};
+    handshake.tv_sec = SHM_HANDSHAKE_TIMEOUT_S;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &handshake, sizeof(handshake));
+
+    ShmLink link; // Owns sock from here on
+    std::string error;
+    if (!link.accept(sock, error)) {
+        log_warn("shared-memory handshake failed", {{"peer", peer}, {"error", error}});
+        link.reset();
+        release_connection();
+        return;
+    }
+    log_info("connection accepted", {{"peer", peer}, {"transport", "shm"}, {"ring", link.ring_size()}});
+
+    // Spinning only pays when the client runs on another core meanwhile.
+    bool spin = std::thread::hardware_concurrency() > 1;
+    LineFramer framer;
+    std::string output; // Replies the outgoing ring had no room for yet
+    size_t output_sent = 0;
+    std::string_view message;
+    std::string_view argument;
+    uint64_t messages = 0;
+    StatsShard& stats = ServerStats::instance().shard();
+    auto last_active = std::chrono::steady_clock::now();
+    while (g_running) {
+        bool progress = false;
+        if (output_sent < output.size()) {
+            size_t sent = link.send(output.data() + output_sent, output.size() - output_sent);
+            stats.count_bytes_out(sent);
+            output_sent += sent;
+            progress = sent > 0;
+            if (output_sent == output.size()) {
+                output.clear();
+                output_sent = 0;
+            }
+        }
+        // Like a reactor connection, stop reading while too many replies wait.
+        size_t pending = output.size() - output_sent;
+        if (pending < high_watermark) {
+            char* space = framer.prepare(RECV_MIN_SPACE);
+            size_t received = link.receive(space, framer.room());
+            framer.commit(received);
+            if (received > 0) {
+                progress = true;
+                stats.count_bytes_in(received);
+                while (framer.next(message)) {
+                    log_sampled(LogLevel::Info, "received", {{"peer", peer}, {"message", message}});
+                    stats.count_message_in();
+                    uint64_t started = stats.start_handler();
+                    const Command* command = find_command(message, argument);
+                    run_inline(command, argument, message, Dispatch::Inline, output);
+                    stats.count_answer(started);
+                    ++messages;
+                }
+                if (framer.overflowed()) {
+                    log_error("message too long", {{"peer", peer}, {"limit", MAX_MESSAGE_SIZE}});
+                    break;
+                }
+            }
+        }
+        if (link.broken()) {
+            log_error("shared region corrupted", {{"peer", peer}});
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (progress) {
+            last_active = now;
+            continue;
+        }
+        if (spin && now - last_active < SHM_SPIN) {
+            continue;
+        }
+        pending = output.size() - output_sent;
+        if ((pending > 0 && !link.want_writable()) || (pending < high_watermark && !link.want_readable())) {
+            continue; // Became ready while the wakeup was being requested
+        }
+        struct pollfd fds[2] = {{link.event_fd(), POLLIN, 0}, {link.socket_fd(), POLLIN | POLLRDHUP, 0}};
+        int ready = poll(fds, 2, EPOLL_TIMEOUT_MS);
+        if (ready < 0 && errno != EINTR) {
+            log_error("poll failed", {{"peer", peer}, {"error", strerror(errno)}});
+            break;
+        }
+        if (ready > 0 && fds[1].revents != 0) {
+            log_info("client disconnected", {{"peer", peer}}); // The protocol sends nothing else on the socket
+            break;
+        }
+        link.clear_wakeups();
+        if (ready == 0 && idle_timeout > 0 &&
+            std::chrono::steady_clock::now() - last_active >= std::chrono::seconds(idle_timeout)) {
+            log_info("connection timed out", {{"peer", peer}, {"reason", "idle"}});
+            break;
+        }
+    }
+
+    g_messages_served.fetch_add(messages, std::memory_order_relaxed);
+    link.reset();
+    release_connection();
+    log_info("connection closed", {{"peer", peer}, {"messages", messages}});
+}
+
+// Accepts clients on a Unix listener until shutdown and serves each on a
+// detached thread: as shared-memory clients if shm is set, otherwise like
+// TCP clients in thread mode.
+void run_local_acceptor(const ServerConfig& config, int listen_fd, bool shm) {
+    while (g_running) {
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, EPOLL_TIMEOUT_MS) <= 0) {
+            continue; // Timed out (time to check g_running) or interrupted
+        }
+        int client_socket = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("accept failed", {{"error", strerror(errno)}});
+            }
+            continue;
+        }
+        if (!admit_connection(config)) {
+            log_warn("connection limit reached", {{"limit", config.max_connections}});
+            close(client_socket);
+            continue;
+        }
+        if (shm) {
+            std::thread(handle_shm_client, client_socket, config.idle_timeout, config.high_watermark).detach();
+        } else {
+            std::thread(handle_client, client_socket, format_local_peer(client_socket), config.idle_timeout).detach();
+        }
+    }
+}
+
+// Opens the Unix listener at path and starts run_local_acceptor on it.
+// Returns the listener, or -1 if it could not be set up.
+int start_local_acceptor(const ServerConfig& config, const std::string& path, bool shm, std::thread& acceptor) {
+    int listen_fd = create_unix_listener(path, config.backlog);
+    if (listen_fd < 0 || !set_non_blocking(listen_fd)) {
+        close_unix_listener(listen_fd, path);
+        return -1;
+    }
+    acceptor = std::thread(run_local_acceptor, std::cref(config), listen_fd, shm);
+    return listen_fd;
+}
+
+// Waits for an acceptor to notice shutdown, then removes its listener.
+void stop_local_acceptor(std::thread& acceptor, int listen_fd, const std::string& path) {
+    g_running = false;
+    if (acceptor.joinable()) {
+        acceptor.join();
+    }
+    close_unix_listener(listen_fd, path);
+}
+
+// Prints how many messages were answered and how many heap allocations
+// happened since baseline. With warm buffer pools the second number tracks
+// connections, not messages.
+void report_allocations(uint64_t baseline) {
+    uint64_t allocations = g_heap_allocations.load() - baseline;
+    std::cout << "Served " << g_messages_served.load() << " message(s) with " << allocations
+              << " heap allocation(s)." << std::endl;
+}
+
+// Parses the command line; returns false (after printing usage) on bad arguments.
+bool parse_args(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--mode" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "threads") {
+                config.mode = ServerMode::Threads;
+            } else if (mode == "epoll") {
+                config.mode = ServerMode::Epoll;
+            } else if (mode == "uring") {
+                config.mode = ServerMode::Uring;
+            } else {
+                std::cerr << "Unknown mode: " << mode << std::endl;
+                return false;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::atoi(argv[++i]);
+            if (config.threads < 0) {
+                std::cerr << "Thread count must not be negative" << std::endl;
+                return false;
+            }
+        } else if (arg == "--backlog" && i + 1 < argc) {
+            config.backlog = std::atoi(argv[++i]);
+            if (config.backlog <= 0) {
+                std::cerr << "Backlog must be positive" << std::endl;
+                return false;
+            }
+        } else if (arg == "--no-pin") {
+            config.pin_threads = false;
+        } else if (arg == "--high-watermark" && i + 1 < argc) {
+            config.high_watermark = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--low-watermark" && i + 1 < argc) {
+            config.low_watermark = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            config.memory_budget = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10)) << 20;
+            if (config.memory_budget == 0) {
+                std::cerr << "Memory budget must be positive" << std::endl;
+                return false;
+            }
+        } else if (arg == "--max-connections" && i + 1 < argc) {
+            config.max_connections = std::atoi(argv[++i]);
+            if (config.max_connections <= 0) {
+                std::cerr << "Connection limit must be positive" << std::endl;
+                return false;
+            }
+        } else if (arg == "--idle-timeout" && i + 1 < argc) {
+            config.idle_timeout = std::atoi(argv[++i]);
+        } else if (arg == "--read-timeout" && i + 1 < argc) {
+            config.read_timeout = std::atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            config.workers = std::atoi(argv[++i]);
+            if (config.workers < 0) {
+                std::cerr << "Worker count must not be negative" << std::endl;
+                return false;
+            }
+        } else if (arg == "--unix" && i + 1 < argc) {
+            config.unix_path = argv[++i];
+        } else if (arg == "--shm" && i + 1 < argc) {
+            config.shm_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            if (!parse_log_level(argv[++i], config.log_level)) {
+                std::cerr << "Unknown log level: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--log-sample" && i + 1 < argc) {
+            int sample = std::atoi(argv[++i]);
+            if (sample <= 0) {
+                std::cerr << "Log sample rate must be positive" << std::endl;
+                return false;
+            }
+            config.log_sample = static_cast<uint32_t>(sample);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--mode epoll|uring|threads] [--threads N] [--backlog N] [--no-pin]"
+                      << " [--high-watermark BYTES] [--low-watermark BYTES] [--memory-budget MIB]"
+                      << " [--max-connections N] [--idle-timeout SECONDS] [--read-timeout SECONDS] [--workers N]"
+                      << " [--unix PATH] [--shm PATH]"
+                      << " [--log-level debug|info|warn|error|off] [--log-sample N]" << std::endl;
+            return false;
+        }
+    }
+    if (config.idle_timeout < 0 || config.read_timeout < 0) {
+        std::cerr << "Timeouts must not be negative" << std::endl;
+        return false;
+    }
+    if (config.high_watermark == 0 || config.low_watermark >= config.high_watermark) {
+        std::cerr << "The low watermark must be below a positive high watermark" << std::endl;
+        return false;
+    }
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (config.threads == 0) {
+        config.threads = cores;
+    }
+    if (config.workers < 0) {
+        config.workers = cores;
+    }
+    return true;
+}
+
+// Signal handler for graceful shutdown
+void signal_handler(int signum) {
+    std::cout << "\nCaught signal " << signum << ". Shutting down server..." << std::endl;
+    g_running = false;
+    // The accepting threads wait in poll() with a timeout, which a handler
+    // never restarts, so they all notice the flag within EPOLL_TIMEOUT_MS.
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    if (!parse_args(argc, argv, config)) {
         return 1;
     }
 
-    std::cout << "Server listening on port " << PORT << "..." << std::endl;
+    // Register signal handler for SIGINT (Ctrl+C)
+    signal(SIGINT, signal_handler);
 
-    // 5. Accept incoming connections in a loop
+    if (config.mode == ServerMode::Uring) {
+        std::string why;
+        if (!uring_supported(why)) {
+            std::cout << "io_uring unavailable (" << why << "); falling back to epoll." << std::endl;
+            config.mode = ServerMode::Epoll;
+        }
+    }
+
+    ServerStats::instance(); // Starts the uptime clock
+    Logger& logger = Logger::instance();
+    logger.set_level(config.log_level);
+    logger.set_sample_every(config.log_sample);
+
+    // Reactors hand expensive commands to this pool. It outlives them, and
+    // its destructor finishes the jobs still queued at shutdown.
+    std::unique_ptr<SimpleThreadPool> compute_pool;
+    if (config.mode != ServerMode::Threads && config.workers > 0) {
+        compute_pool = std::make_unique<SimpleThreadPool>(static_cast<size_t>(config.workers));
+        g_compute_pool = compute_pool.get();
+    }
+
+    uint64_t allocation_baseline = g_heap_allocations.load();
+
+    // Shared-memory clients get threads of their own in every mode.
+    std::thread shm_acceptor;
+    int shm_fd = -1;
+    if (!config.shm_path.empty()) {
+        shm_fd = start_local_acceptor(config, config.shm_path, true, shm_acceptor);
+        if (shm_fd < 0) {
+            return 1;
+        }
+        std::cout << "Accepting shared-memory clients on " << config.shm_path << "..." << std::endl;
+    }
+
+    if (config.mode != ServerMode::Threads) {
+        // Every reactor opens, serves and closes its own listening socket
+        bool uring = config.mode == ServerMode::Uring;
+        logger.start();
+        bool served = run_reactors(config, uring ? run_uring_loop : run_event_loop, uring ? "io_uring" : "epoll");
+        stop_local_acceptor(shm_acceptor, shm_fd, config.shm_path);
+        g_compute_pool = nullptr;
+        compute_pool.reset();
+        logger.stop();
+        if (!served) {
+            return 1;
+        }
+        report_allocations(allocation_baseline);
+        std::cout << "Server shutdown complete." << std::endl;
+        return 0;
+    }
+
+    // 1-4. Create, bind and listen on a single socket
+    int server_fd = create_listener(config.backlog, false);
+    if (server_fd < 0) {
+        stop_local_acceptor(shm_acceptor, shm_fd, config.shm_path);
+        return 1;
+    }
+    // Unix socket clients are accepted by a thread of their own
+    std::thread local_acceptor;
+    int local_fd = -1;
+    if (!config.unix_path.empty()) {
+        local_fd = start_local_acceptor(config, config.unix_path, false, local_acceptor);
+        if (local_fd < 0) {
+            close(server_fd);
+            stop_local_acceptor(shm_acceptor, shm_fd, config.shm_path);
+            return 1;
+        }
+    }
+
+    std::cout << "Server listening on port " << PORT
+              << (local_fd >= 0 ? " and on " + config.unix_path : std::string()) << "..." << std::endl;
+    logger.start();
+
+    // 5. Accept incoming connections in a loop (thread-per-connection mode).
+    // signal() installs the handler with SA_RESTART, which would restart a
+    // blocking accept() after Ctrl+C, so wait for connections in poll() instead.
     while (g_running) {
-        struct sockaddr_in client_addr;
+        struct pollfd pfd = {server_fd, POLLIN, 0};
+        if (poll(&pfd, 1, EPOLL_TIMEOUT_MS) <= 0) {
+            continue; // Timed out (time to check g_running) or interrupted
+        }
+        struct sockaddr_storage client_addr;
         socklen_t client_addr_len = sizeof(client_addr);
         int client_socket = accept(server_fd, (struct sockaddr*)&client_addr, &client_addr_len);
 
@@ -147,21 +2128,31 @@ int main() {
             if (errno == EINTR && !g_running) {
                  break; // Graceful shutdown requested
             }
-            std::cerr << "Error accepting connection: " << strerror(errno) << std::endl;
+            log_error("accept failed", {{"error", strerror(errno)}});
             continue; // Continue listening for other connections
         }
+        if (!admit_connection(config)) {
+            log_warn("connection limit reached", {{"limit", config.max_connections}});
+            close(client_socket);
+            continue;
+        }
 
         // Create a new thread to handle the client connection
         // Detach the thread: the thread is responsible for closing its own socket.
         // The main thread doesn't need to join it.
-        std::thread client_thread(handle_client, client_socket, client_addr);
+        std::thread client_thread(handle_client, client_socket, format_peer(client_addr, client_socket),
+                                  config.idle_timeout);
         client_thread.detach();
     }
 
-    // Cleanup: Close the listening socket when loop terminates
+    // Cleanup: Close the listening sockets when loop terminates
+    stop_local_acceptor(local_acceptor, local_fd, config.unix_path);
+    stop_local_acceptor(shm_acceptor, shm_fd, config.shm_path);
+    logger.stop(); // Connections still open log synchronously from here on
     std::cout << "Closing listening socket." << std::endl;
     close(server_fd);
 
+    report_allocations(allocation_baseline); // Counts the connections that have already closed
     std::cout << "Server shutdown complete." << std::endl;
     return 0;
 }
\ No newline at end of file
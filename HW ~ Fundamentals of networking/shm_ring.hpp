@@ -0,0 +1,389 @@
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+// Shared-memory transport for clients on the same host, used by both the
+// server and the client.
+//
+// The client creates a sealed memfd holding two single-producer /
+// single-consumer byte rings (requests and replies) and hands it, with two
+// eventfds, to the server over a Unix socket (SCM_RIGHTS). From then on
+// messages travel through the rings with the same newline framing as TCP,
+// so "hello" and echo behave exactly as they do over a socket. The socket
+// stays open only so that each side notices when the other goes away.
+//
+// Signalling costs a system call only when the other side is asleep: a side
+// about to block sets the ring's waiting flag and looks once more, and the
+// other side, after moving the ring's index, writes the sleeper's eventfd
+// only if it finds that flag set. Both steps are sequentially consistent,
+// so one of them always sees the other (no lost wakeups). Everything in the
+// shared region may be scribbled on by the peer: each side keeps its own
+// index privately and treats an impossible fill level as a broken link.
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+constexpr uint32_t SHM_MAGIC = 0x6d68734e; // "Nshm"
+constexpr uint32_t SHM_VERSION = 1;
+constexpr uint64_t SHM_DEFAULT_RING_SIZE = 256 * 1024; // Bytes per direction
+constexpr uint64_t SHM_MIN_RING_SIZE = 4096;
+constexpr uint64_t SHM_MAX_RING_SIZE = 64 * 1024 * 1024;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory rings need address-free atomics");
+
+// Indices of one ring, each on its own cache line so that the two sides do
+// not keep stealing one line from each other.
+struct ShmRingState {
+    alignas(64) std::atomic<uint64_t> head{0}; // Bytes ever written (producer)
+    alignas(64) std::atomic<uint64_t> tail{0}; // Bytes ever read (consumer)
+    alignas(64) std::atomic<uint32_t> reader_waiting{0}; // Consumer is blocking until data arrives
+    std::atomic<uint32_t> writer_waiting{0};             // Producer is blocking until room appears
+};
+
+// Start of the shared region; the request ring's bytes follow it, then the reply ring's.
+struct ShmRegionHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ring_size; // Power of two
+    ShmRingState requests; // Client to server
+    ShmRingState replies;  // Server to client
+};
+
+constexpr size_t SHM_DATA_OFFSET = (sizeof(ShmRegionHeader) + 63) & ~size_t{63};
+
+inline size_t shm_region_size(uint64_t ring_size) {
+    return SHM_DATA_OFFSET + 2 * ring_size;
+}
+
+// One side's view of one ring.
+class ShmRing {
+public:
+    void attach(ShmRingState* state, char* data, uint64_t size, bool producer) {
+        state_ = state;
+        data_ = data;
+        size_ = size;
+        // Our own index starts where the region was created (zero); the peer's is read each time.
+        own_ = producer ? state->head.load() : state->tail.load();
+    }
+
+    // Producer: copies up to n bytes in; returns how many fit.
+    size_t write(const char* bytes, size_t n) {
+        uint64_t used = own_ - state_->tail.load(std::memory_order_acquire);
+        if (used > size_) {
+            broken_ = true;
+            return 0;
+        }
+        size_t take = static_cast<size_t>(std::min<uint64_t>(n, size_ - used));
+        copy_in(bytes, take);
+        own_ += take;
+        state_->head.store(own_, std::memory_order_seq_cst);
+        return take;
+    }
+
+    // Consumer: copies up to n bytes out; returns how many there were.
+    size_t read(char* out, size_t n) {
+        uint64_t available = state_->head.load(std::memory_order_acquire) - own_;
+        if (available > size_) {
+            broken_ = true;
+            return 0;
+        }
+        size_t take = static_cast<size_t>(std::min<uint64_t>(n, available));
+        copy_out(out, take);
+        own_ += take;
+        state_->tail.store(own_, std::memory_order_seq_cst);
+        return take;
+    }
+
+    // Consumer: true if read() would return something.
+    bool readable() const { return state_->head.load(std::memory_order_seq_cst) != own_; }
+    // Producer: true if write() would take something.
+    bool writable() const { return own_ - state_->tail.load(std::memory_order_seq_cst) < size_; }
+
+    // True once the peer has left the indices in an impossible state.
+    bool broken() const { return broken_; }
+
+    ShmRingState* state() const { return state_; }
+
+private:
+    void copy_in(const char* bytes, size_t n) {
+        size_t at = static_cast<size_t>(own_ & (size_ - 1));
+        size_t first = std::min<size_t>(n, static_cast<size_t>(size_) - at);
+        memcpy(data_ + at, bytes, first);
+        memcpy(data_, bytes + first, n - first);
+    }
+
+    void copy_out(char* out, size_t n) {
+        size_t at = static_cast<size_t>(own_ & (size_ - 1));
+        size_t first = std::min<size_t>(n, static_cast<size_t>(size_) - at);
+        memcpy(out, data_ + at, first);
+        memcpy(out + first, data_, n - first);
+    }
+
+    ShmRingState* state_ = nullptr;
+    char* data_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t own_ = 0; // Our index, never read back from shared memory
+    bool broken_ = false;
+};
+
+// One end of a shared-memory link: the mapped region, its two rings, our
+// eventfd (written by the peer to wake us) and the peer's, and the socket.
+class ShmLink {
+public:
+    ShmLink() = default;
+    ShmLink(const ShmLink&) = delete;
+    ShmLink& operator=(const ShmLink&) = delete;
+    ~ShmLink() { reset(); }
+
+    // Client side: creates the region and hands it to the server listening on
+    // the Unix socket path. Returns false with error set on failure.
+    bool connect(const std::string& path, std::string& error, uint64_t ring_size = SHM_DEFAULT_RING_SIZE) {
+        reset();
+        size_t region_size = shm_region_size(ring_size);
+        int memfd = memfd_create("hello-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        peer_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); // The server's; it gets a copy
+        own_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        bool ok = memfd >= 0 && peer_event_fd_ >= 0 && own_event_fd_ >= 0 &&
+                  ftruncate(memfd, static_cast<off_t>(region_size)) == 0 &&
+                  fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0 &&
+                  map(memfd, region_size);
+        if (!ok) {
+            error = std::string("cannot create shared region: ") + strerror(errno);
+        } else {
+            auto* header = new (region_) ShmRegionHeader();
+            header->magic = SHM_MAGIC;
+            header->version = SHM_VERSION;
+            header->ring_size = ring_size;
+            attach(header, ring_size, false);
+            ok = dial(path, memfd, error);
+        }
+        if (memfd >= 0) {
+            close(memfd); // The mapping keeps the region alive
+        }
+        if (!ok) {
+            reset();
+        }
+        return ok;
+    }
+
+    // Server side: takes the region offered on the accepted Unix socket sock
+    // (adopting sock). Returns false with error set if the offer is unusable.
+    bool accept(int sock, std::string& error) {
+        reset();
+        socket_fd_ = sock;
+        char tag = 0;
+        int fds[3] = {-1, -1, -1};
+        bool received = receive_fds(sock, tag, fds);
+        own_event_fd_ = fds[1]; // Owned (and closed by reset()) whatever happens next
+        peer_event_fd_ = fds[2];
+        // The client may not shrink the region under us (that would be SIGBUS), so it must be sealed.
+        struct stat st;
+        int seals = received ? fcntl(fds[0], F_GET_SEALS) : -1;
+        bool ok = received && tag == 'S' && seals >= 0 && (seals & F_SEAL_SHRINK) && fstat(fds[0], &st) == 0 &&
+                  static_cast<size_t>(st.st_size) >= SHM_DATA_OFFSET && map(fds[0], static_cast<size_t>(st.st_size));
+        if (fds[0] >= 0) {
+            close(fds[0]);
+        }
+        if (!ok) {
+            error = received ? "bad shared region" : "no shared region offered";
+            return false;
+        }
+        auto* header = static_cast<ShmRegionHeader*>(region_);
+        uint64_t ring_size = header->ring_size; // Read once: the client could change it later
+        if (header->magic != SHM_MAGIC || header->version != SHM_VERSION || ring_size < SHM_MIN_RING_SIZE ||
+            ring_size > SHM_MAX_RING_SIZE || (ring_size & (ring_size - 1)) != 0 ||
+            region_size_ < shm_region_size(ring_size)) {
+            error = "unsupported shared region layout";
+            return false;
+        }
+        attach(header, ring_size, true);
+        char ack = 'K';
+        if (::send(sock, &ack, 1, MSG_NOSIGNAL) != 1) {
+            error = std::string("cannot acknowledge: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Sends up to n bytes; returns how many fit in the ring. Wakes the peer if it waits for data.
+    size_t send(const char* bytes, size_t n) {
+        size_t sent = out_.write(bytes, n);
+        if (sent > 0 && out_.state()->reader_waiting.exchange(0) != 0) {
+            wake_peer();
+        }
+        return sent;
+    }
+
+    // Receives up to n bytes; returns how many were there. Wakes the peer if it waits for room.
+    size_t receive(char* out, size_t n) {
+        size_t got = in_.read(out, n);
+        if (got > 0 && in_.state()->writer_waiting.exchange(0) != 0) {
+            wake_peer();
+        }
+        return got;
+    }
+
+    bool readable() const { return in_.readable(); }
+    bool writable() const { return out_.writable(); }
+
+    // Before blocking on event_fd(): asks to be woken when data arrives.
+    // Returns false (asking nothing) if data is already there.
+    bool want_readable() {
+        in_.state()->reader_waiting.store(1);
+        if (in_.readable()) {
+            in_.state()->reader_waiting.store(0);
+            return false;
+        }
+        return true;
+    }
+
+    // Before blocking on event_fd(): asks to be woken when the outgoing ring
+    // has room. Returns false (asking nothing) if it already has.
+    bool want_writable() {
+        out_.state()->writer_waiting.store(1);
+        if (out_.writable()) {
+            out_.state()->writer_waiting.store(0);
+            return false;
+        }
+        return true;
+    }
+
+    // Resets event_fd() after a wakeup.
+    void clear_wakeups() {
+        uint64_t count;
+        ssize_t got = ::read(own_event_fd_, &count, sizeof(count));
+        (void)got; // EAGAIN: nothing to clear
+    }
+
+    int event_fd() const { return own_event_fd_; } // Readable when the peer woke us
+    int socket_fd() const { return socket_fd_; }   // Hangs up when the peer goes away
+    uint64_t ring_size() const { return ring_size_; }
+    bool broken() const { return in_.broken() || out_.broken(); }
+
+    void reset() {
+        if (region_ != nullptr) {
+            munmap(region_, region_size_);
+            region_ = nullptr;
+        }
+        for (int* fd : {&socket_fd_, &own_event_fd_, &peer_event_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+private:
+    bool map(int memfd, size_t size) {
+        void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (region == MAP_FAILED) {
+            return false;
+        }
+        region_ = region;
+        region_size_ = size;
+        return true;
+    }
+
+    void attach(ShmRegionHeader* header, uint64_t ring_size, bool server) {
+        char* data = static_cast<char*>(region_) + SHM_DATA_OFFSET;
+        ring_size_ = ring_size;
+        ShmRing& requests = server ? in_ : out_;
+        ShmRing& replies = server ? out_ : in_;
+        requests.attach(&header->requests, data, ring_size_, !server);
+        replies.attach(&header->replies, data + ring_size_, ring_size_, server);
+    }
+
+    void wake_peer() {
+        uint64_t one = 1;
+        ssize_t written = write(peer_event_fd_, &one, sizeof(one));
+        (void)written; // Only fails if the counter is saturated, which is a wakeup anyway
+    }
+
+    // Connects to path, passes the region and both eventfds, and waits for the acknowledgement.
+    bool dial(const std::string& path, int memfd, std::string& error) {
+        struct sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            error = "socket path too long";
+            return false;
+        }
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        socket_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket_fd_ < 0 || ::connect(socket_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            error = "cannot connect to " + path + ": " + strerror(errno);
+            return false;
+        }
+        // The server is woken through the first eventfd and wakes us through the second.
+        int fds[3] = {memfd, peer_event_fd_, own_event_fd_};
+        char tag = 'S';
+        struct iovec iov = {&tag, 1};
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        char ack = 0;
+        if (sendmsg(socket_fd_, &msg, MSG_NOSIGNAL) != 1 || recv(socket_fd_, &ack, 1, 0) != 1 || ack != 'K') {
+            error = "server refused the shared region";
+            return false;
+        }
+        return true;
+    }
+
+    // Receives the one-byte offer and the descriptors passed with it.
+    static bool receive_fds(int sock, char& tag, int (&fds)[3]) {
+        struct iovec iov = {&tag, 1};
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) {
+            return false;
+        }
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            return false;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fds, CMSG_DATA(cmsg), std::min<size_t>(count, 3) * sizeof(int));
+        for (size_t i = 3; i < count; ++i) {
+            int extra;
+            memcpy(&extra, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            close(extra); // More than we asked for
+        }
+        return count == 3 && !(msg.msg_flags & MSG_CTRUNC);
+    }
+
+    void* region_ = nullptr;
+    size_t region_size_ = 0;
+    uint64_t ring_size_ = 0;
+    ShmRing in_;  // Requests on the server side, replies on the client side
+    ShmRing out_; // The other one
+    int socket_fd_ = -1;
+    int own_event_fd_ = -1;
+    int peer_event_fd_ = -1;
+};
+
+#endif
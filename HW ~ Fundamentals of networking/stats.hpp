@@ -0,0 +1,194 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// Live server statistics, reported by the "stats" command.
+//
+// Every thread that serves clients (event loops, client threads, compute
+// workers) counts into a StatsShard of its own. Each counter has a single
+// writer, so it is bumped with a relaxed load and store on cache lines no
+// other thread writes: the data path never locks or contends. Shards are
+// handed out by ThreadSlots, so a thread that exits leaves its shard, counts
+// included, for the next new thread to adopt. A report walks the shards and
+// adds them up, so it takes no lock either and sees counts at most a few
+// operations old. Nothing a report computes depends on earlier reports, so
+// any number of clients can poll at once.
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "LatencyHistogram.hpp" // From "HW ~ Multithreading" (see the Makefile)
+#include "thread_slots.hpp"
+
+// One in this many messages has its handler timed: two clock reads and a
+// histogram update on every echo would cost more than the echo itself.
+constexpr uint32_t STATS_HANDLER_SAMPLE = 16;
+
+// accepts_per_s averages the accepts of the last this many seconds.
+constexpr uint64_t STATS_ACCEPT_WINDOW_S = 10;
+constexpr size_t STATS_ACCEPT_BUCKETS = 16; // One per second; more than the window, so none is reused while read
+
+// The clock of the handler histogram, in nanoseconds.
+inline uint64_t stats_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// The counters of one thread. Only that thread writes them.
+class alignas(64) StatsShard {
+public:
+    void count_accept() {
+        bump(accepted_);
+        // Accepts are rare next to messages, so reading the clock here is cheap.
+        uint64_t second = stats_clock_ns() / 1000000000ull;
+        AcceptBucket& bucket = accept_buckets_[second % STATS_ACCEPT_BUCKETS];
+        if (bucket.second.load(std::memory_order_relaxed) != second) {
+            bucket.count.store(0, std::memory_order_relaxed);
+            bucket.second.store(second, std::memory_order_release);
+        }
+        bump(bucket.count);
+    }
+    void count_reject() { bump(rejected_); }
+    void count_close() { bump(closed_); }
+    void count_message_in() { bump(messages_in_); }
+    void count_bytes_in(uint64_t n) { bump(bytes_in_, n); }
+    void count_bytes_out(uint64_t n) { bump(bytes_out_, n); }
+    void count_recv_error() { bump(recv_errors_); }
+    void count_send_error() { bump(send_errors_); }
+
+    // Call as a message's handler starts; pass the result to count_answer().
+    // Returns the time for the messages that are timed, 0 for the others.
+    uint64_t start_handler() {
+        if (sample_countdown_ > 0) {
+            --sample_countdown_;
+            return 0;
+        }
+        sample_countdown_ = STATS_HANDLER_SAMPLE - 1;
+        return stats_clock_ns();
+    }
+
+    // A message was answered; its handler started at started (see start_handler()).
+    void count_answer(uint64_t started) {
+        bump(messages_out_);
+        if (started != 0) {
+            handler_.Record(stats_clock_ns() - started);
+        }
+    }
+
+private:
+    friend class ServerStats;
+
+    // Accepts during one second of the monotonic clock.
+    struct AcceptBucket {
+        std::atomic<uint64_t> second{0};
+        std::atomic<uint64_t> count{0};
+    };
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0}; // Refused at the connection limit
+    std::atomic<uint64_t> closed_{0};
+    std::atomic<uint64_t> messages_in_{0};
+    std::atomic<uint64_t> messages_out_{0};
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<uint64_t> bytes_out_{0};
+    std::atomic<uint64_t> recv_errors_{0};
+    std::atomic<uint64_t> send_errors_{0};
+    LatencyHistogram handler_; // Time to answer a message, nanoseconds (sampled)
+    uint32_t sample_countdown_ = 0; // Messages until the next timed one; private to the owner
+    AcceptBucket accept_buckets_[STATS_ACCEPT_BUCKETS];
+};
+
+class ServerStats {
+public:
+    // The process-wide statistics. Never destroyed, so detached threads may
+    // keep counting while the process exits.
+    static ServerStats& instance() {
+        static ServerStats* stats = new ServerStats();
+        return *stats;
+    }
+
+    // The calling thread's shard: adopted from an exited thread if possible.
+    StatsShard& shard() { return shards_.local(); }
+
+    // Appends one line of key=value pairs (without a newline). The accept
+    // rate covers the last STATS_ACCEPT_WINDOW_S seconds (or the uptime, if shorter).
+    void report(std::string& out) {
+        uint64_t now = stats_clock_ns();
+        uint64_t now_second = now / 1000000000ull;
+        // The window ends with the current second
+        uint64_t first_second = now_second + 1 > STATS_ACCEPT_WINDOW_S ? now_second + 1 - STATS_ACCEPT_WINDOW_S : 0;
+        uint64_t window_start = std::max<uint64_t>(started_ns_, first_second * 1000000000ull);
+
+        uint64_t accepted = 0, rejected = 0, closed = 0, messages_in = 0, messages_out = 0;
+        uint64_t bytes_in = 0, bytes_out = 0, recv_errors = 0, send_errors = 0, recent_accepts = 0;
+        LatencyHistogram handler;
+        shards_.for_each([&](StatsShard& s) {
+            accepted += s.accepted_.load(std::memory_order_relaxed);
+            rejected += s.rejected_.load(std::memory_order_relaxed);
+            closed += s.closed_.load(std::memory_order_relaxed);
+            messages_in += s.messages_in_.load(std::memory_order_relaxed);
+            messages_out += s.messages_out_.load(std::memory_order_relaxed);
+            bytes_in += s.bytes_in_.load(std::memory_order_relaxed);
+            bytes_out += s.bytes_out_.load(std::memory_order_relaxed);
+            recv_errors += s.recv_errors_.load(std::memory_order_relaxed);
+            send_errors += s.send_errors_.load(std::memory_order_relaxed);
+            handler.Merge(s.handler_);
+            for (const StatsShard::AcceptBucket& bucket : s.accept_buckets_) {
+                uint64_t second = bucket.second.load(std::memory_order_acquire);
+                if (second >= first_second && second <= now_second) {
+                    recent_accepts += bucket.count.load(std::memory_order_relaxed);
+                }
+            }
+        });
+        double window = static_cast<double>(now - window_start) / 1e9;
+        double accept_rate = window > 0.0 ? static_cast<double>(recent_accepts) / window : 0.0;
+
+        // out may already hold earlier replies, so every pair after the first brings its own separator.
+        out += "uptime_s=" + std::to_string((now - started_ns_) / 1000000000ull);
+        auto put = [&out](const char* key, uint64_t value) {
+            out += ' ';
+            out += key;
+            out += '=';
+            out += std::to_string(value);
+        };
+        auto put_real = [&out](const char* key, double value) {
+            char text[32];
+            snprintf(text, sizeof(text), " %s=%.1f", key, value);
+            out += text;
+        };
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        // A close may be seen before the accept it follows (they can be on different shards).
+        put("connections", accepted > closed ? accepted - closed : 0);
+        put("accepted", accepted);
+        put("rejected", rejected);
+        put_real("accepts_per_s", accept_rate);
+        put("messages_in", messages_in);
+        put("messages_out", messages_out);
+        put("bytes_in", bytes_in);
+        put("bytes_out", bytes_out);
+        put("recv_errors", recv_errors);
+        put("send_errors", send_errors);
+        put_real("handler_p50_us", us(handler.Percentile(50.0)));
+        put_real("handler_p99_us", us(handler.Percentile(99.0)));
+        put_real("handler_p999_us", us(handler.Percentile(99.9)));
+        put_real("handler_max_us", us(handler.Max()));
+        put_real("handler_mean_us", handler.Mean() / 1000.0);
+    }
+
+private:
+    ServerStats() : started_ns_(stats_clock_ns()) {}
+
+    ThreadSlots<StatsShard> shards_;
+    uint64_t started_ns_;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef THREAD_SLOTS_HPP
+#define THREAD_SLOTS_HPP
+
+// Per-thread objects of a process-wide singleton (the logger's rings, the
+// statistics shards).
+//
+// Every thread that asks gets a Slot of its own, so it can write it without
+// locking. Slots sit in a lock-free list that only grows: a thread that
+// exits releases its slot, contents included, for the next new thread to
+// adopt, and readers walk the list without a lock while threads come and go.
+//
+// The calling thread's slot is cached in a thread_local shared by every
+// ThreadSlots<Slot> of the same Slot type, so each Slot type must have a
+// single instance, and that instance must never be destroyed.
+
+#include <atomic>
+
+template <typename Slot>
+class ThreadSlots {
+public:
+    ThreadSlots() = default;
+    ThreadSlots(const ThreadSlots&) = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    // The calling thread's slot: adopted from an exited thread if possible.
+    Slot& local() {
+        thread_local Handle handle;
+        if (handle.node == nullptr) {
+            handle.node = adopt();
+        }
+        return handle.node->slot;
+    }
+
+    // Calls fn(slot) for every slot, in use or not.
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+        for (Node* node = head_.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+            fn(node->slot);
+        }
+    }
+
+private:
+    struct Node {
+        Slot slot;
+        std::atomic<bool> in_use{true}; // Cleared when the owning thread exits, so another thread can adopt the slot
+        Node* next = nullptr;           // Set before the node is published, never changed after
+    };
+
+    // Releases the thread's slot when the thread exits.
+    struct Handle {
+        Node* node = nullptr;
+        ~Handle() {
+            if (node != nullptr) {
+                node->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    Node* adopt() {
+        for (Node* node = head_.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+            bool expected = false;
+            if (node->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                return node;
+            }
+        }
+        auto* node = new Node();
+        node->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        return node;
+    }
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+#endif
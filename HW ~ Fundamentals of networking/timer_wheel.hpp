@@ -0,0 +1,150 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+// A hierarchical timing wheel for connection timeouts.
+//
+// Time is counted in ticks. Level 0 has one slot per tick for the next 64
+// ticks; each higher level has 64 slots that each cover 64 times as many
+// ticks as a slot one level down, so four levels reach 64^4 ticks ahead.
+// When a lower level wraps around, the matching higher-level slot is
+// cascaded: its timers are spread over the levels below. Timers are
+// intrusive (a TimerNode lives inside the object it times), so arming,
+// re-arming and cancelling are O(1) list operations that never allocate,
+// and advancing costs one step per elapsed tick plus one per expired or
+// cascaded timer. Not thread-safe; each event loop owns a wheel.
+
+#include <cstddef>
+#include <cstdint>
+
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr; // nullptr while not scheduled
+    uint64_t expires = 0;      // Tick at which the timer fires
+    void* owner = nullptr;     // The object this node belongs to, for the expiry callback
+
+    bool scheduled() const { return next != nullptr; }
+};
+
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t MAX_DELAY = (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1; // In ticks
+
+    explicit TimerWheel(uint64_t now = 0) : current_(now) {
+        for (auto& level : slots_) {
+            for (TimerNode& head : level) {
+                head.prev = head.next = &head;
+            }
+        }
+    }
+    TimerWheel(const TimerWheel&) = delete; // Slot heads point at themselves
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    uint64_t now() const { return current_; }
+
+    // (Re)arms node to fire at tick expires; a past tick fires on the next advance.
+    // Delays beyond MAX_DELAY are clamped.
+    void schedule(TimerNode* node, uint64_t expires) {
+        if (node->scheduled()) {
+            unlink(node);
+        }
+        if (expires <= current_) {
+            expires = current_ + 1;
+        } else if (expires - current_ > MAX_DELAY) {
+            expires = current_ + MAX_DELAY;
+        }
+        node->expires = expires;
+        link(node);
+    }
+
+    void cancel(TimerNode* node) {
+        if (node->scheduled()) {
+            unlink(node);
+        }
+    }
+
+    // Moves time forward to tick now, calling on_expired(node) for every timer
+    // that fires, already unscheduled (so the callback may re-arm it or free
+    // its owner). Returns the number of expired timers.
+    template <typename Fn>
+    size_t advance(uint64_t now, Fn&& on_expired) {
+        size_t expired = 0;
+        while (current_ < now) {
+            ++current_;
+            // Cascade every level whose lower neighbour just wrapped, highest first.
+            unsigned top = 0;
+            while (top + 1 < LEVELS && (current_ & ((uint64_t{1} << (SLOT_BITS * (top + 1))) - 1)) == 0) {
+                ++top;
+            }
+            for (unsigned level = top; level >= 1; --level) {
+                cascade(level, slot_index(current_, level));
+            }
+
+            // Detach the due slot first: callbacks may schedule new timers.
+            TimerNode due;
+            splice(slots_[0][slot_index(current_, 0)], due);
+            while (due.next != &due) {
+                TimerNode* node = due.next;
+                unlink(node);
+                on_expired(node);
+                ++expired;
+            }
+        }
+        return expired;
+    }
+
+private:
+    static unsigned slot_index(uint64_t tick, unsigned level) {
+        return static_cast<unsigned>((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    }
+
+    void link(TimerNode* node) {
+        uint64_t delta = node->expires - current_;
+        unsigned level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        TimerNode& head = slots_[level][slot_index(node->expires, level)];
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    static void unlink(TimerNode* node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = nullptr;
+    }
+
+    // Moves every node of list from onto the empty list to.
+    static void splice(TimerNode& from, TimerNode& to) {
+        if (from.next == &from) {
+            to.prev = to.next = &to;
+            return;
+        }
+        to.next = from.next;
+        to.prev = from.prev;
+        to.next->prev = &to;
+        to.prev->next = &to;
+        from.prev = from.next = &from;
+    }
+
+    // Re-files the timers of one higher-level slot, which now fall within reach of the levels below.
+    void cascade(unsigned level, unsigned index) {
+        TimerNode pending;
+        splice(slots_[level][index], pending);
+        while (pending.next != &pending) {
+            TimerNode* node = pending.next;
+            unlink(node);
+            link(node);
+        }
+    }
+
+    TimerNode slots_[LEVELS][SLOTS]; // List heads
+    uint64_t current_;               // Last tick processed
+};
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef URING_HPP
+#define URING_HPP
+
+// A minimal io_uring wrapper written directly against the system calls, so the
+// server does not depend on liburing. It covers what the echo server needs: one
+// ring per thread, submission/completion handling, opcode probing and provided
+// buffer rings. Nothing here is thread-safe; each ring belongs to one thread.
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+inline int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+inline int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              const void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+inline int sys_io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+class UringRing {
+public:
+    UringRing() = default;
+    UringRing(const UringRing&) = delete;
+    UringRing& operator=(const UringRing&) = delete;
+    ~UringRing() { destroy(); }
+
+    // Creates the ring and maps its queues. Returns 0 or -errno.
+    int init(unsigned entries, unsigned cq_entries) {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+        params.cq_entries = cq_entries;
+
+        ring_fd_ = sys_io_uring_setup(entries, &params);
+        if (ring_fd_ < 0) {
+            ring_fd_ = -1;
+            return -errno;
+        }
+        features_ = params.features;
+
+        sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            sq_map_size_ = cq_map_size_ = (sq_map_size_ > cq_map_size_ ? sq_map_size_ : cq_map_size_);
+        }
+        sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_map_ == MAP_FAILED) {
+            sq_map_ = nullptr;
+            return fail();
+        }
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            cq_map_ = sq_map_;
+        } else {
+            cq_map_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_map_ == MAP_FAILED) {
+                cq_map_ = nullptr;
+                return fail();
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes_ = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                       MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED) {
+            sqes_ = nullptr;
+            return fail();
+        }
+
+        char* sq = static_cast<char*>(sq_map_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i) {
+            array[i] = i; // Entry i of the ring always refers to sqes_[i]
+        }
+        sqe_tail_ = *sq_tail_;
+
+        char* cq = static_cast<char*>(cq_map_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        return 0;
+    }
+
+    void destroy() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (cq_map_ != nullptr && cq_map_ != sq_map_) {
+            munmap(cq_map_, cq_map_size_);
+        }
+        cq_map_ = nullptr;
+        if (sq_map_ != nullptr) {
+            munmap(sq_map_, sq_map_size_);
+            sq_map_ = nullptr;
+        }
+        if (ring_fd_ >= 0) {
+            close(ring_fd_);
+            ring_fd_ = -1;
+        }
+    }
+
+    int fd() const { return ring_fd_; }
+    unsigned features() const { return features_; }
+
+    // Next free submission entry, zeroed. Submits queued entries first if the
+    // queue is full; returns nullptr only if that submission fails.
+    struct io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            if (submit_and_wait(0, -1) < 0) {
+                return nullptr;
+            }
+            head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (sqe_tail_ - head >= sq_entries_) {
+                return nullptr;
+            }
+        }
+        struct io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        memset(sqe, 0, sizeof(*sqe));
+        ++sqe_tail_;
+        return sqe;
+    }
+
+    // Makes sure the next n get_sqe() calls succeed without submitting in
+    // between (which would split a chain of linked entries), submitting what
+    // is queued first if needed. Returns false if n entries cannot be freed.
+    bool reserve(unsigned n) {
+        if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + n <= sq_entries_) {
+            return true;
+        }
+        if (submit_and_wait(0, -1) < 0) {
+            return false;
+        }
+        return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + n <= sq_entries_;
+    }
+
+    // Submits everything queued and, if wait_nr > 0, waits for that many
+    // completions or until timeout_ms passes (-1: no timeout). This is the
+    // only system call in the steady state. Returns >= 0 or -errno; a timeout
+    // is not an error.
+    int submit_and_wait(unsigned wait_nr, int timeout_ms) {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+        unsigned flags = 0;
+        const void* arg = nullptr;
+        size_t arg_size = 0;
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg getevents;
+        if (wait_nr > 0) {
+            flags |= IORING_ENTER_GETEVENTS;
+            if (timeout_ms >= 0) {
+                ts.tv_sec = timeout_ms / 1000;
+                ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+                memset(&getevents, 0, sizeof(getevents));
+                getevents.ts = reinterpret_cast<uint64_t>(&ts);
+                flags |= IORING_ENTER_EXT_ARG;
+                arg = &getevents;
+                arg_size = sizeof(getevents);
+            }
+        } else if (to_submit == 0) {
+            return 0;
+        }
+
+        while (true) {
+            int ret = sys_io_uring_enter(ring_fd_, to_submit, wait_nr, flags, arg, arg_size);
+            if (ret >= 0) {
+                return ret;
+            }
+            if (errno == EINTR && wait_nr == 0) {
+                continue;
+            }
+            if (errno == ETIME || errno == EINTR) {
+                return 0; // Timed out or interrupted while waiting: let the caller look around
+            }
+            return -errno;
+        }
+    }
+
+    // Calls fn(const io_uring_cqe&) for every completion available now and
+    // then hands the slots back to the kernel. Returns how many were seen.
+    template <typename Fn>
+    unsigned for_each_cqe(Fn&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned seen = 0;
+        for (; head != tail; ++head, ++seen) {
+            fn(cqes_[head & cq_mask_]);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return seen;
+    }
+
+    // True if the kernel implements every opcode in ops.
+    bool supports_ops(std::initializer_list<int> ops) const {
+        constexpr unsigned kProbeOps = 256;
+        std::vector<char> storage(sizeof(struct io_uring_probe) + kProbeOps * sizeof(struct io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<struct io_uring_probe*>(storage.data());
+        if (sys_io_uring_register(ring_fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+            return false;
+        }
+        for (int op : ops) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int fail() {
+        int err = errno;
+        destroy();
+        return -err;
+    }
+
+    int ring_fd_ = -1;
+    unsigned features_ = 0;
+
+    void* sq_map_ = nullptr;
+    void* cq_map_ = nullptr;
+    size_t sq_map_size_ = 0;
+    size_t cq_map_size_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0; // Entries handed out locally, published on submit
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    struct io_uring_cqe* cqes_ = nullptr;
+};
+
+// A provided buffer ring: a group of equally sized receive buffers that the
+// kernel picks from when a recv completes (IOSQE_BUFFER_SELECT), so no buffer
+// has to be committed to a connection before data actually arrives.
+class BufferRing {
+public:
+    BufferRing() = default;
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+    ~BufferRing() { destroy(); }
+
+    // Registers count buffers (a power of two) of size bytes as group on ring.
+    // Returns 0 or -errno.
+    int init(UringRing& ring, unsigned short group, unsigned count, unsigned size) {
+        ring_ = &ring;
+        group_ = group;
+        count_ = count;
+        size_ = size;
+
+        ring_size_ = count * sizeof(struct io_uring_buf);
+        void* mem = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return -errno;
+        }
+        buf_ring_ = static_cast<struct io_uring_buf_ring*>(mem);
+
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (sys_io_uring_register(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            int err = errno;
+            munmap(buf_ring_, ring_size_);
+            buf_ring_ = nullptr;
+            return -err;
+        }
+        registered_ = true;
+
+        storage_.resize(static_cast<size_t>(count) * size);
+        for (unsigned bid = 0; bid < count; ++bid) {
+            recycle(static_cast<unsigned short>(bid));
+        }
+        return 0;
+    }
+
+    void destroy() {
+        if (registered_ && ring_ != nullptr && ring_->fd() >= 0) {
+            struct io_uring_buf_reg reg;
+            memset(&reg, 0, sizeof(reg));
+            reg.bgid = group_;
+            sys_io_uring_register(ring_->fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+        registered_ = false;
+        if (buf_ring_ != nullptr) {
+            munmap(buf_ring_, ring_size_);
+            buf_ring_ = nullptr;
+        }
+    }
+
+    unsigned short group() const { return group_; }
+    const char* buffer(unsigned short bid) const { return storage_.data() + static_cast<size_t>(bid) * size_; }
+
+    // Gives buffer bid back to the kernel.
+    void recycle(unsigned short bid) {
+        // The ring is an array of io_uring_buf whose first entry's resv field
+        // doubles as the tail. Index it directly: in C++ the header's flexible
+        // array member can end up behind a one-byte empty struct, at offset 8.
+        struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(buf_ring_) + (tail_ & (count_ - 1));
+        buf->addr = reinterpret_cast<uint64_t>(storage_.data() + static_cast<size_t>(bid) * size_);
+        buf->len = size_;
+        buf->bid = bid;
+        ++tail_;
+        __atomic_store_n(&buf_ring_->tail, tail_, __ATOMIC_RELEASE);
+    }
+
+private:
+    UringRing* ring_ = nullptr;
+    struct io_uring_buf_ring* buf_ring_ = nullptr;
+    size_t ring_size_ = 0;
+    bool registered_ = false;
+    unsigned short group_ = 0;
+    unsigned count_ = 0;
+    unsigned size_ = 0;
+    unsigned short tail_ = 0;
+    std::vector<char> storage_;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "CpuTopology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+
+namespace {
+
+bool ReadFirstLine(const std::string& path, std::string& line) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, line));
+}
+
+int ParseInt(const std::string& text) {
+    std::size_t used = 0;
+    int value = std::stoi(text, &used);
+    if (used != text.size() || value < 0) {
+        throw std::invalid_argument("Invalid CPU number: " + text);
+    }
+    return value;
+}
+
+std::string Trim(const std::string& text) {
+    auto first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return {};
+    }
+    auto last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+std::vector<int> CpuTopology::ParseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(Trim(text));
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        range = Trim(range);
+        if (range.empty()) {
+            continue;
+        }
+        auto dash = range.find('-');
+        try {
+            if (dash == std::string::npos) {
+                cpus.push_back(ParseInt(range));
+            } else {
+                int first = ParseInt(range.substr(0, dash));
+                int last = ParseInt(range.substr(dash + 1));
+                if (last < first) {
+                    throw std::invalid_argument("Invalid CPU range: " + range);
+                }
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+        } catch (const std::out_of_range&) {
+            throw std::invalid_argument("Invalid CPU list: " + text);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+CpuTopology CpuTopology::SingleNode(std::vector<int> cpus) {
+    if (cpus.empty()) {
+        unsigned count = std::thread::hardware_concurrency();
+        for (unsigned cpu = 0; cpu < (count == 0 ? 1 : count); ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    CpuTopology topology;
+    NumaNode node;
+    node.cpus = std::move(cpus);
+    node.distances = {10};
+    topology.m_nodes.push_back(std::move(node));
+    return topology;
+}
+
+CpuTopology CpuTopology::Detect() {
+    return FromSysfs("/sys/devices/system");
+}
+
+CpuTopology CpuTopology::FromSysfs(const std::string& systemRoot) {
+    std::vector<int> online;
+    std::string line;
+    try {
+        if (ReadFirstLine(systemRoot + "/cpu/online", line)) {
+            online = ParseCpuList(line);
+        }
+    } catch (const std::invalid_argument&) {
+        online.clear();
+    }
+
+#if defined(__linux__)
+    std::vector<std::size_t> ids;
+    if (DIR* dir = opendir((systemRoot + "/node").c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                ids.push_back(static_cast<std::size_t>(std::stoul(name.substr(4))));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    CpuTopology topology;
+    for (std::size_t id : ids) {
+        std::string base = systemRoot + "/node/node" + std::to_string(id);
+        NumaNode node;
+        node.id = id;
+        try {
+            if (ReadFirstLine(base + "/cpulist", line)) {
+                node.cpus = ParseCpuList(line);
+            }
+        } catch (const std::invalid_argument&) {
+            continue;
+        }
+        // Keep only online CPUs; memory-only nodes end up empty and are skipped.
+        if (!online.empty()) {
+            node.cpus.erase(std::remove_if(node.cpus.begin(), node.cpus.end(),
+                                           [&online](int cpu) {
+                                               return !std::binary_search(online.begin(), online.end(), cpu);
+                                           }),
+                            node.cpus.end());
+        }
+        if (node.cpus.empty()) {
+            continue;
+        }
+
+        // "distance" lists one value per node id, in id order.
+        std::vector<int> byId;
+        if (ReadFirstLine(base + "/distance", line)) {
+            std::stringstream ss(line);
+            int d;
+            while (ss >> d) {
+                byId.push_back(d);
+            }
+        }
+        node.distances = std::move(byId);
+        topology.m_nodes.push_back(std::move(node));
+    }
+
+    if (!topology.m_nodes.empty()) {
+        // Re-index distances by position in m_nodes (ids can be sparse).
+        for (NumaNode& node : topology.m_nodes) {
+            std::vector<int> distances;
+            for (const NumaNode& other : topology.m_nodes) {
+                bool known = other.id < node.distances.size();
+                distances.push_back(known ? node.distances[other.id] : (other.id == node.id ? 10 : 20));
+            }
+            node.distances = std::move(distances);
+        }
+        return topology;
+    }
+#endif
+
+    return SingleNode(std::move(online));
+}
+
+std::vector<int> CpuTopology::Cpus() const {
+    std::vector<int> cpus;
+    for (const NumaNode& node : m_nodes) {
+        cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+    }
+    return cpus;
+}
+
+std::size_t CpuTopology::NodeOfCpu(int cpu) const noexcept {
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        const std::vector<int>& cpus = m_nodes[i].cpus;
+        if (std::binary_search(cpus.begin(), cpus.end(), cpu)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+std::vector<std::size_t> CpuTopology::NodesByDistance(std::size_t node) const {
+    std::vector<std::size_t> others;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        if (i != node) {
+            others.push_back(i);
+        }
+    }
+    const std::vector<int>& distances = m_nodes[node].distances;
+    std::stable_sort(others.begin(), others.end(), [&distances](std::size_t a, std::size_t b) {
+        return distances[a] < distances[b];
+    });
+    return others;
+}
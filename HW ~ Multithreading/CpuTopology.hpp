@@ -0,0 +1,58 @@
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One NUMA node: the CPUs it contains and its distance to every node.
+ */
+struct NumaNode {
+    std::size_t id = 0;
+    std::vector<int> cpus;
+    std::vector<int> distances; // distances[other node index], as reported by the kernel (10 = local)
+};
+
+/**
+ * @brief CPU and NUMA layout of the machine, used to place pool workers.
+ *
+ * On Linux it is read from sysfs (/sys/devices/system/node and
+ * /sys/devices/system/cpu); everywhere else, or if sysfs is unavailable, it
+ * degrades to a single node holding std::thread::hardware_concurrency() CPUs.
+ */
+class CpuTopology {
+public:
+    static CpuTopology Detect();
+
+    /**
+     * @brief Reads the topology below a sysfs-like root (e.g. "/sys/devices/system").
+     * Returns a single-node fallback if nothing usable is found there.
+     */
+    static CpuTopology FromSysfs(const std::string& systemRoot);
+
+    /**
+     * @brief Parses a kernel CPU list such as "0-3,8,10-11".
+     * @throws std::invalid_argument on malformed input.
+     */
+    static std::vector<int> ParseCpuList(const std::string& text);
+
+    const std::vector<NumaNode>& Nodes() const noexcept { return m_nodes; }
+    std::size_t NodeCount() const noexcept { return m_nodes.size(); }
+
+    // All CPUs in node order.
+    std::vector<int> Cpus() const;
+
+    // Index (into Nodes()) of the node that owns cpu, or 0 if unknown.
+    std::size_t NodeOfCpu(int cpu) const noexcept;
+
+    // Other nodes of `node`, nearest first.
+    std::vector<std::size_t> NodesByDistance(std::size_t node) const;
+
+private:
+    static CpuTopology SingleNode(std::vector<int> cpus);
+
+    std::vector<NumaNode> m_nodes;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size, HDR-style histogram of durations in nanoseconds.
+ *
+ * Values are bucketed log-linearly: every power of two is split into 32
+ * equal sub-buckets, so any recorded value is reported with at most ~3%
+ * relative error over the full 64-bit range, using a constant ~15 KB of
+ * memory and no allocation. Recording is a single relaxed atomic increment,
+ * so one histogram can be written by several threads and read (approximately)
+ * while being written.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 6;
+    static constexpr std::uint64_t kSubBucketCount = std::uint64_t(1) << kSubBucketBits; // 64
+    static constexpr std::uint64_t kSubBucketHalf = kSubBucketCount / 2;                  // 32
+    static constexpr std::size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketHalf + kSubBucketHalf;
+
+    LatencyHistogram() noexcept { Reset(); }
+
+    LatencyHistogram(const LatencyHistogram& other) noexcept { CopyFrom(other); }
+    LatencyHistogram& operator=(const LatencyHistogram& other) noexcept {
+        if (this != &other) {
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    void Record(std::uint64_t nanos) noexcept {
+        m_counts[BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+        m_total.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(nanos, std::memory_order_relaxed);
+
+        std::uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (nanos > max && !m_max.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Adds the counts of other into this histogram (used to aggregate snapshots).
+    void Merge(const LatencyHistogram& other) noexcept {
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            std::uint64_t n = other.m_counts[i].load(std::memory_order_relaxed);
+            if (n != 0) {
+                m_counts[i].fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+        m_total.fetch_add(other.m_total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        std::uint64_t otherMax = other.m_max.load(std::memory_order_relaxed);
+        std::uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (otherMax > max && !m_max.compare_exchange_weak(max, otherMax, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Reset() noexcept {
+        for (auto& c : m_counts) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        m_total.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Count() const noexcept { return m_total.load(std::memory_order_relaxed); }
+    std::uint64_t Max() const noexcept { return m_max.load(std::memory_order_relaxed); }
+    double Mean() const noexcept {
+        std::uint64_t n = Count();
+        return n == 0 ? 0.0 : static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(n);
+    }
+
+    /**
+     * @brief Value at the given percentile (0-100), e.g. Percentile(99.0) for p99.
+     * Returns the upper edge of the bucket holding that rank (capped at Max()), or 0 if empty.
+     */
+    std::uint64_t Percentile(double percentile) const noexcept {
+        std::uint64_t total = Count();
+        if (total == 0) {
+            return 0;
+        }
+        if (percentile < 0.0) {
+            percentile = 0.0;
+        }
+        if (percentile > 100.0) {
+            percentile = 100.0;
+        }
+
+        std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            seen += m_counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                std::uint64_t upper = BucketUpperBound(i);
+                std::uint64_t max = Max();
+                return upper < max ? upper : max;
+            }
+        }
+        return Max();
+    }
+
+    static std::size_t BucketIndex(std::uint64_t value) noexcept {
+        if (value < kSubBucketCount) {
+            return static_cast<std::size_t>(value);
+        }
+        unsigned msb = 63 - CountLeadingZeros(value);
+        unsigned shift = msb - (kSubBucketBits - 1);
+        // (value >> shift) lies in [kSubBucketHalf, kSubBucketCount)
+        return static_cast<std::size_t>(shift * kSubBucketHalf + (value >> shift));
+    }
+
+    static std::uint64_t BucketUpperBound(std::size_t index) noexcept {
+        if (index < kSubBucketCount) {
+            return index;
+        }
+        std::size_t shift = (index - kSubBucketHalf) / kSubBucketHalf;
+        std::uint64_t sub = index - shift * kSubBucketHalf;
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    static unsigned CountLeadingZeros(std::uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned n = 0;
+        for (std::uint64_t bit = std::uint64_t(1) << 63; (value & bit) == 0; bit >>= 1) {
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    void CopyFrom(const LatencyHistogram& other) noexcept {
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            m_counts[i].store(other.m_counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        m_total.store(other.m_total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_sum.store(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_max.store(other.m_max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> m_counts;
+    std::atomic<std::uint64_t> m_total;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Bounded lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's design).
+ *
+ * The ring holds a power-of-two number of cells, each with a sequence number
+ * telling whether it is ready to be written (sequence == position) or read
+ * (sequence == position + 1). Producers and consumers claim a position with one
+ * CAS on their own index and never touch each other's, so the two indices live
+ * on separate cache lines. Neither side ever waits for the other: a full or
+ * empty queue is reported to the caller, who decides whether to retry.
+ *
+ * T must be default constructible and move assignable.
+ */
+template <typename T>
+class BoundedMpmcQueue {
+public:
+    /**
+     * @param capacity Number of slots, rounded up to a power of two (at least 2).
+     */
+    explicit BoundedMpmcQueue(std::size_t capacity) :
+        m_capacity(RoundUp(capacity)), m_mask(m_capacity - 1), m_cells(new Cell[m_capacity])
+    {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+    /**
+     * @brief Appends value unless the queue is full. value is only moved from on success.
+     */
+    bool TryPush(T&& value) {
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[pos & m_mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // The cell still holds the value from one lap ago
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed); // Another producer got there first
+            }
+        }
+    }
+
+    /**
+     * @brief Removes the oldest value into out, unless the queue is empty.
+     */
+    bool TryPop(T& out) {
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[pos & m_mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.value = T(); // Release resources held by the moved-from value now
+                    cell.sequence.store(pos + m_capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Not written yet
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::size_t Capacity() const noexcept { return m_capacity; }
+
+    // Approximate while other threads push or pop; exact when quiescent.
+    std::size_t SizeApprox() const noexcept {
+        std::size_t tail = m_dequeuePos.load(std::memory_order_acquire);
+        std::size_t head = m_enqueuePos.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+    bool EmptyApprox() const noexcept { return SizeApprox() == 0; }
+
+private:
+    static constexpr std::size_t kLineSize = 64;
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    static std::size_t RoundUp(std::size_t n) {
+        std::size_t capacity = 2;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    const std::size_t m_capacity;
+    const std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(kLineSize) std::atomic<std::size_t> m_enqueuePos{0};
+    alignas(kLineSize) std::atomic<std::size_t> m_dequeuePos{0};
+    char m_padding[kLineSize - sizeof(std::atomic<std::size_t>)]; // Keep whatever follows off the consumers' line
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef PARALLEL_ALGORITHMS_HPP
+#define PARALLEL_ALGORITHMS_HPP
+
+#include "SimpleThreadPool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Loop-level algorithms built on top of SimpleThreadPool.
+//
+// The index range is cut into chunks of `grain` elements. A handful of helper
+// tasks (at most one per worker) are posted to the pool and the calling thread
+// joins in; every participant repeatedly claims the next chunk with a single
+// atomic increment until the range is exhausted. The user callable is invoked
+// in a tight inner loop, so the per-element cost is just the call itself.
+//
+// The caller only ever waits for chunks that another thread has already
+// claimed (and is therefore actively running), never for a helper task that is
+// still sitting in the queue. This keeps nested calls from inside a worker
+// deadlock-free even when every worker is busy.
+
+namespace parallel_detail {
+
+// Number of chunks handed out per participant when the grain is chosen
+// automatically. A few chunks per thread smooth out uneven iteration costs.
+constexpr std::size_t kChunksPerThread = 8;
+
+inline std::size_t AutoGrain(std::size_t count, std::size_t participants) {
+    std::size_t grain = count / (kChunksPerThread * participants);
+    return grain == 0 ? 1 : grain;
+}
+
+// State shared between the caller and the helper tasks. Held by shared_ptr
+// because helpers that start late may outlive the call that created them.
+template <typename ChunkFn>
+struct ChunkedLoop {
+    ChunkedLoop(std::size_t count, std::size_t grain, ChunkFn fn) :
+        count(count), grain(grain), chunkCount((count + grain - 1) / grain),
+        remaining(chunkCount), fn(std::move(fn)) {}
+
+    // Claims and runs chunks until none are left.
+    void Run() {
+        while (true) {
+            std::size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunkCount) {
+                return;
+            }
+
+            // After a failure the remaining chunks are still claimed (so the
+            // bookkeeping adds up) but no longer executed.
+            if (!failed.load(std::memory_order_relaxed)) {
+                std::size_t begin = chunk * grain;
+                std::size_t end = (count - begin < grain) ? count : begin + grain;
+                try {
+                    fn(chunk, begin, end);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mut);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mut);
+                finished.notify_all();
+            }
+        }
+    }
+
+    // Waits for chunks still running on other threads, then rethrows the
+    // first exception thrown by the user callable, if any.
+    void Wait() {
+        if (remaining.load(std::memory_order_acquire) != 0) {
+            std::unique_lock<std::mutex> lock(mut);
+            finished.wait(lock, [this] { return remaining.load(std::memory_order_acquire) == 0; });
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    const std::size_t count;
+    const std::size_t grain;
+    const std::size_t chunkCount;
+
+    std::atomic<std::size_t> nextChunk{0};
+    std::atomic<std::size_t> remaining; // Chunks not yet finished (or skipped)
+    std::atomic<bool> failed{false};
+
+    std::mutex mut; // Protects error; pairs with finished
+    std::condition_variable finished;
+    std::exception_ptr error;
+
+    ChunkFn fn;
+};
+
+// Runs fn(chunkIndex, begin, end) over [0, count) split into chunks of
+// `grain` elements (0 = choose automatically), using the pool and the
+// calling thread. Returns the grain that was used.
+template <typename ChunkFn>
+std::size_t RunChunked(SimpleThreadPool& pool, std::size_t count, std::size_t grain, ChunkFn fn) {
+    if (count == 0) {
+        return grain == 0 ? 1 : grain;
+    }
+
+    std::size_t workers = pool.ThreadCount();
+    if (grain == 0) {
+        grain = AutoGrain(count, workers + 1);
+    }
+
+    std::size_t chunkCount = (count + grain - 1) / grain;
+    std::size_t helpers = (chunkCount - 1 < workers) ? chunkCount - 1 : workers;
+
+    // Not worth a round trip through the queue: run inline.
+    if (helpers == 0) {
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            std::size_t begin = chunk * grain;
+            std::size_t end = (count - begin < grain) ? count : begin + grain;
+            fn(chunk, begin, end);
+        }
+        return grain;
+    }
+
+    auto loop = std::make_shared<ChunkedLoop<ChunkFn>>(count, grain, std::move(fn));
+
+    for (std::size_t i = 0; i < helpers; ++i) {
+        try {
+            pool.Execute([loop]() { loop->Run(); });
+        } catch (const std::runtime_error&) {
+            break; // Pool is stopping; the caller finishes the range alone.
+        }
+    }
+
+    loop->Run();
+    loop->Wait();
+    return grain;
+}
+
+} // namespace parallel_detail
+
+/**
+ * @brief Calls body(i) for every i in [first, last), in parallel.
+ * @param pool The pool providing helper threads; the calling thread also participates.
+ * @param first, last The half-open index range.
+ * @param body Callable invoked as body(Index). Must be safe to call concurrently.
+ * @param grain Number of consecutive indices per chunk; 0 picks one automatically.
+ * @throws Rethrows the first exception thrown by body, after all running chunks finish.
+ */
+template <typename Index, typename Body>
+void parallel_for(SimpleThreadPool& pool, Index first, Index last, Body body, std::size_t grain = 0) {
+    static_assert(std::is_integral<Index>::value, "parallel_for requires an integral index type");
+    if (!(first < last)) {
+        return;
+    }
+
+    std::size_t count = static_cast<std::size_t>(last - first);
+    parallel_detail::RunChunked(pool, count, grain,
+        [first, &body](std::size_t, std::size_t begin, std::size_t end) {
+            Index stop = first + static_cast<Index>(end);
+            for (Index i = first + static_cast<Index>(begin); i < stop; ++i) {
+                body(i);
+            }
+        });
+}
+
+/**
+ * @brief Maps every index in [first, last) and folds the results.
+ * @param identity Neutral element of reduce; each chunk starts from a copy of it.
+ * @param map Callable invoked as map(Index), returning a value convertible to T.
+ * @param reduce Associative binary operation T(T, T). Partial results are combined
+ *        in index order, so reduce does not need to be commutative.
+ * @param grain Number of consecutive indices per chunk; 0 picks one automatically.
+ * @return The reduction of all mapped values, or identity for an empty range.
+ */
+template <typename Index, typename T, typename Map, typename Reduce>
+T parallel_reduce(SimpleThreadPool& pool, Index first, Index last, T identity,
+                  Map map, Reduce reduce, std::size_t grain = 0) {
+    static_assert(std::is_integral<Index>::value, "parallel_reduce requires an integral index type");
+    if (!(first < last)) {
+        return identity;
+    }
+
+    std::size_t count = static_cast<std::size_t>(last - first);
+    if (grain == 0) {
+        grain = parallel_detail::AutoGrain(count, pool.ThreadCount() + 1);
+    }
+
+    // One slot per chunk so that partial results can be combined in order.
+    std::vector<T> partials((count + grain - 1) / grain, identity);
+
+    parallel_detail::RunChunked(pool, count, grain,
+        [first, &map, &reduce, &partials](std::size_t chunk, std::size_t begin, std::size_t end) {
+            T acc = partials[chunk];
+            Index stop = first + static_cast<Index>(end);
+            for (Index i = first + static_cast<Index>(begin); i < stop; ++i) {
+                acc = reduce(std::move(acc), map(i));
+            }
+            partials[chunk] = std::move(acc);
+        });
+
+    T result = std::move(identity);
+    for (T& partial : partials) {
+        result = reduce(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+/**
+ * @brief Parallel equivalent of std::transform for random access ranges.
+ * @param inFirst, inLast The input range.
+ * @param outFirst Start of the output range; must hold at least (inLast - inFirst) elements.
+ * @param op Unary operation applied to every input element.
+ * @param grain Number of consecutive elements per chunk; 0 picks one automatically.
+ * @return Iterator past the last element written.
+ */
+template <typename InputIt, typename OutputIt, typename UnaryOp>
+OutputIt parallel_transform(SimpleThreadPool& pool, InputIt inFirst, InputIt inLast,
+                            OutputIt outFirst, UnaryOp op, std::size_t grain = 0) {
+    static_assert(std::is_base_of<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<InputIt>::iterator_category>::value,
+                  "parallel_transform requires random access input iterators");
+
+    auto count = std::distance(inFirst, inLast);
+    if (count <= 0) {
+        return outFirst;
+    }
+
+    parallel_detail::RunChunked(pool, static_cast<std::size_t>(count), grain,
+        [inFirst, outFirst, &op](std::size_t, std::size_t begin, std::size_t end) {
+            InputIt in = inFirst + static_cast<std::ptrdiff_t>(begin);
+            InputIt inEnd = inFirst + static_cast<std::ptrdiff_t>(end);
+            OutputIt out = outFirst + static_cast<std::ptrdiff_t>(begin);
+            for (; in != inEnd; ++in, ++out) {
+                *out = op(*in);
+            }
+        });
+
+    return outFirst + count;
+}
+
+#endif
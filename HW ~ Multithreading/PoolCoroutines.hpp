@@ -0,0 +1,284 @@
+#ifndef POOL_COROUTINES_HPP
+#define POOL_COROUTINES_HPP
+
+#include "SimpleThreadPool.hpp"
+#include "PoolFuture.hpp"
+
+#ifndef SIMPLE_THREAD_POOL_HAS_COROUTINES
+#error "PoolCoroutines.hpp requires C++20 coroutine support (compile with -std=c++20)"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// C++20 coroutine support for SimpleThreadPool.
+//
+//   PoolTask<int> Work(SimpleThreadPool& pool) {
+//       co_await pool.Schedule();              // continue on a worker
+//       int a = co_await pool.Submit(Compute); // suspend, no thread is parked
+//       co_return a + 1;
+//   }
+//   int result = sync_wait(Work(pool));        // only the top level blocks
+//
+// Suspended coroutines are put in the pool's run queue as bare handles
+// (see SimpleThreadPool::Resume), so each resumption costs one queue push.
+
+template <typename T>
+class PoolTask;
+
+namespace coro_detail {
+
+// Common part of PoolTask promises: resumes the awaiting coroutine (if any)
+// by symmetric transfer when the task finishes.
+class PromiseBase {
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+            std::coroutine_handle<> next = self.promise().m_continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() noexcept { m_error = std::current_exception(); }
+
+    void SetContinuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+
+protected:
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_error;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+public:
+    PoolTask<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& value) { m_slot.Emplace(std::forward<U>(value)); }
+
+    T Result() {
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+        return m_slot.Take();
+    }
+
+private:
+    pool_detail::ValueSlot<T> m_slot;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+public:
+    PoolTask<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void Result() {
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+};
+
+} // namespace coro_detail
+
+/**
+ * @brief Lazily started coroutine task. Starts when awaited (or passed to sync_wait)
+ * and resumes its awaiter directly when it completes.
+ */
+template <typename T = void>
+class PoolTask {
+public:
+    using promise_type = coro_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit PoolTask(Handle handle) noexcept : m_handle(handle) {}
+    PoolTask(PoolTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    PoolTask& operator=(PoolTask&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    PoolTask(const PoolTask&) = delete;
+    PoolTask& operator=(const PoolTask&) = delete;
+
+    ~PoolTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool valid() const noexcept { return static_cast<bool>(m_handle); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            Handle handle;
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().SetContinuation(awaiting);
+                return handle; // Start the task on this thread
+            }
+            T await_resume() { return handle.promise().Result(); }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    Handle m_handle;
+};
+
+namespace coro_detail {
+
+template <typename T>
+PoolTask<T> Promise<T>::get_return_object() noexcept {
+    return PoolTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline PoolTask<void> Promise<void>::get_return_object() noexcept {
+    return PoolTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// One-shot event used by sync_wait to block the top-level caller.
+class SyncEvent {
+public:
+    void Set() {
+        // Notify under the lock: the waiter may destroy this object as soon as it returns.
+        std::lock_guard<std::mutex> lock(m_mut);
+        m_set = true;
+        m_condition.notify_all();
+    }
+    void Wait() {
+        std::unique_lock<std::mutex> lock(m_mut);
+        m_condition.wait(lock, [this] { return m_set; });
+    }
+private:
+    std::mutex m_mut;
+    std::condition_variable m_condition;
+    bool m_set = false;
+};
+
+// Minimal coroutine that drives a PoolTask and signals a SyncEvent when it finishes.
+class SyncWaitTask {
+public:
+    struct promise_type {
+        SyncEvent* event = nullptr;
+
+        SyncWaitTask get_return_object() noexcept {
+            return SyncWaitTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        auto final_suspend() const noexcept {
+            struct Signal {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> self) const noexcept {
+                    self.promise().event->Set();
+                }
+                void await_resume() const noexcept {}
+            };
+            return Signal{};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); } // The body catches everything
+    };
+
+    explicit SyncWaitTask(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+    SyncWaitTask(SyncWaitTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    ~SyncWaitTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    void Run(SyncEvent& event) {
+        m_handle.promise().event = &event;
+        m_handle.resume();
+        event.Wait();
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template <typename T>
+SyncWaitTask MakeSyncWaitTask(PoolTask<T>& task, std::optional<pool_detail::ValueSlot<T>>& out,
+                              std::exception_ptr& error) {
+    try {
+        out.emplace();
+        if constexpr (std::is_void<T>::value) {
+            co_await std::move(task);
+        } else {
+            out->Emplace(co_await std::move(task));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+}
+
+} // namespace coro_detail
+
+/**
+ * @brief Runs a task to completion and blocks the calling thread until it is done.
+ * Meant for the top level (e.g. main); do not call it from a worker thread.
+ * @return The task's result; rethrows the exception the task ended with.
+ */
+template <typename T>
+T sync_wait(PoolTask<T> task) {
+    std::optional<pool_detail::ValueSlot<T>> out;
+    std::exception_ptr error;
+    coro_detail::SyncEvent event;
+
+    coro_detail::SyncWaitTask waiter = coro_detail::MakeSyncWaitTask(task, out, error);
+    waiter.Run(event);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return out->Take();
+}
+
+/**
+ * @brief Makes PoolFuture awaitable: `T value = co_await future;`.
+ * The coroutine is resumed on the future's pool once the result is ready
+ * (or inline by the completing thread if the future has no pool).
+ */
+template <typename T>
+auto operator co_await(PoolFuture<T>&& future) {
+    struct Awaiter {
+        PoolFuture<T> future;
+
+        bool await_ready() const noexcept { return future.is_ready(); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            SimpleThreadPool* pool = future.Pool();
+            future.OnReady([pool, handle]() {
+                if (pool == nullptr) {
+                    handle.resume();
+                    return;
+                }
+                try {
+                    pool->Resume(handle);
+                } catch (const std::runtime_error&) {
+                    handle.resume(); // Pool stopped: finish on the completing thread
+                }
+            });
+        }
+        T await_resume() { return future.get(); }
+    };
+    return Awaiter{std::move(future)};
+}
+
+#endif
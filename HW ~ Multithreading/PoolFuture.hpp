@@ -0,0 +1,405 @@
+#ifndef POOL_FUTURE_HPP
+#define POOL_FUTURE_HPP
+
+#include "SimpleThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Futures for SimpleThreadPool that support continuations.
+//
+// Unlike std::future, a PoolFuture can have work attached to it with then(),
+// when_all() and when_any(). Attached work is registered as a callback on the
+// shared state and posted to the pool by whichever thread completes the
+// predecessor, so nothing ever blocks waiting for a dependency. get() and
+// wait() still block and should not be used from inside a worker.
+
+namespace pool_detail {
+
+// Storage for the result of a task, with a void specialization.
+template <typename T>
+struct ValueSlot {
+    std::optional<T> value;
+
+    template <typename... Args>
+    void Emplace(Args&&... args) { value.emplace(std::forward<Args>(args)...); }
+    T Take() { return std::move(*value); }
+};
+
+template <>
+struct ValueSlot<void> {
+    void Emplace() {}
+    void Take() {}
+};
+
+template <typename T>
+class SharedState {
+public:
+    template <typename... Args>
+    void SetValue(Args&&... args) {
+        std::vector<std::function<void()>> toRun;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (ready.load(std::memory_order_relaxed)) {
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            }
+            slot.Emplace(std::forward<Args>(args)...);
+            ready.store(true, std::memory_order_release);
+            toRun.swap(callbacks);
+        }
+        Finish(toRun);
+    }
+
+    void SetException(std::exception_ptr e) {
+        std::vector<std::function<void()>> toRun;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (ready.load(std::memory_order_relaxed)) {
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            }
+            error = std::move(e);
+            ready.store(true, std::memory_order_release);
+            toRun.swap(callbacks);
+        }
+        Finish(toRun);
+    }
+
+    // Runs cb once the state is ready: immediately if it already is,
+    // otherwise on the thread that completes it.
+    void OnReady(std::function<void()> cb) {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (!ready.load(std::memory_order_relaxed)) {
+                callbacks.push_back(std::move(cb));
+                return;
+            }
+        }
+        cb();
+    }
+
+    bool IsReady() const noexcept { return ready.load(std::memory_order_acquire); }
+
+    void Wait() {
+        if (IsReady()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        condition.wait(lock, [this] { return ready.load(std::memory_order_relaxed); });
+    }
+
+    template <typename Rep, typename Period>
+    bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) {
+        if (IsReady()) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        return condition.wait_for(lock, timeout, [this] { return ready.load(std::memory_order_relaxed); });
+    }
+
+    T Take() {
+        Wait();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return slot.Take();
+    }
+
+private:
+    void Finish(std::vector<std::function<void()>>& toRun) {
+        condition.notify_all();
+        for (auto& cb : toRun) {
+            cb();
+        }
+    }
+
+    std::mutex mut;
+    std::condition_variable condition;
+    std::atomic<bool> ready{false};
+    ValueSlot<T> slot;
+    std::exception_ptr error;
+    std::vector<std::function<void()>> callbacks;
+};
+
+// Invokes fn(args...) and stores its result (or exception) in state.
+template <typename R, typename Fn, typename... Args>
+void Fulfil(SharedState<R>& state, Fn& fn, Args&&... args) {
+    try {
+        if constexpr (std::is_void<R>::value) {
+            fn(std::forward<Args>(args)...);
+            state.SetValue();
+        } else {
+            state.SetValue(fn(std::forward<Args>(args)...));
+        }
+    } catch (...) {
+        state.SetException(std::current_exception());
+    }
+}
+
+// Result type of a continuation taking the value of a PoolFuture<T>.
+template <typename T, typename Fn, typename = void>
+struct ContinuationResult {
+    using type = std::invoke_result_t<Fn, T>;
+};
+
+template <typename T, typename Fn>
+struct ContinuationResult<T, Fn, std::enable_if_t<std::is_void<T>::value>> {
+    using type = std::invoke_result_t<Fn>;
+};
+
+} // namespace pool_detail
+
+/**
+ * @brief Future returned by SimpleThreadPool::Submit(), with continuation support.
+ * Like std::future it is move-only and its value can be retrieved once.
+ */
+template <typename T>
+class PoolFuture {
+public:
+    PoolFuture() = default;
+    PoolFuture(std::shared_ptr<pool_detail::SharedState<T>> state, SimpleThreadPool* pool) :
+        m_state(std::move(state)), m_pool(pool) {}
+
+    PoolFuture(PoolFuture&&) noexcept = default;
+    PoolFuture& operator=(PoolFuture&&) noexcept = default;
+    PoolFuture(const PoolFuture&) = delete;
+    PoolFuture& operator=(const PoolFuture&) = delete;
+
+    bool valid() const noexcept { return m_state != nullptr; }
+    bool is_ready() const noexcept { return m_state && m_state->IsReady(); }
+
+    /**
+     * @brief Blocks until the result is available. Avoid calling from a worker thread.
+     */
+    void wait() const { CheckValid(); m_state->Wait(); }
+
+    /**
+     * @brief Blocks until the result is available or the timeout expires.
+     * Never returns std::future_status::deferred.
+     */
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        CheckValid();
+        return m_state->WaitFor(timeout) ? std::future_status::ready : std::future_status::timeout;
+    }
+
+    /**
+     * @brief Blocks until ready, then returns the value or rethrows the stored exception.
+     * Invalidates the future.
+     */
+    T get() {
+        CheckValid();
+        auto state = std::move(m_state);
+        return state->Take();
+    }
+
+    /**
+     * @brief Attaches a continuation that runs on the pool once this future is ready.
+     * @param fn Called with the value (or with no arguments for PoolFuture<void>).
+     *        If this future holds an exception, fn is skipped and the exception
+     *        is forwarded to the returned future.
+     * @return A future for fn's result. Invalidates this future.
+     */
+    template <typename Fn>
+    auto then(Fn fn) -> PoolFuture<typename pool_detail::ContinuationResult<T, Fn>::type> {
+        using R = typename pool_detail::ContinuationResult<T, Fn>::type;
+        CheckValid();
+
+        auto prev = std::move(m_state);
+        auto next = std::make_shared<pool_detail::SharedState<R>>();
+        auto shared = std::make_shared<Fn>(std::move(fn)); // std::function needs a copyable target
+        SimpleThreadPool* pool = m_pool;
+
+        auto run = [prev, next, shared]() {
+            if constexpr (std::is_void<T>::value) {
+                try {
+                    prev->Take();
+                } catch (...) {
+                    next->SetException(std::current_exception());
+                    return;
+                }
+                pool_detail::Fulfil(*next, *shared);
+            } else {
+                std::optional<T> value;
+                try {
+                    value.emplace(prev->Take());
+                } catch (...) {
+                    next->SetException(std::current_exception());
+                    return;
+                }
+                pool_detail::Fulfil(*next, *shared, std::move(*value));
+            }
+        };
+
+        prev->OnReady([pool, next, run]() {
+            if (pool == nullptr) {
+                run();
+                return;
+            }
+            try {
+                pool->Execute(run);
+            } catch (...) {
+                next->SetException(std::current_exception()); // Pool already stopped
+            }
+        });
+
+        return PoolFuture<R>(std::move(next), pool);
+    }
+
+    // Used by when_all / when_any to observe completion without consuming the value.
+    void OnReady(std::function<void()> cb) { CheckValid(); m_state->OnReady(std::move(cb)); }
+    SimpleThreadPool* Pool() const noexcept { return m_pool; }
+
+private:
+    void CheckValid() const {
+        if (!m_state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    std::shared_ptr<pool_detail::SharedState<T>> m_state;
+    SimpleThreadPool* m_pool = nullptr; // Where continuations run; nullptr = inline
+};
+
+/**
+ * @brief Producer side of a PoolFuture, for results computed outside the pool.
+ */
+template <typename T>
+class PoolPromise {
+public:
+    explicit PoolPromise(SimpleThreadPool* pool = nullptr) :
+        m_state(std::make_shared<pool_detail::SharedState<T>>()), m_pool(pool) {}
+
+    PoolFuture<T> get_future() const { return PoolFuture<T>(m_state, m_pool); }
+
+    template <typename... Args>
+    void set_value(Args&&... args) { m_state->SetValue(std::forward<Args>(args)...); }
+    void set_exception(std::exception_ptr e) { m_state->SetException(std::move(e)); }
+
+private:
+    std::shared_ptr<pool_detail::SharedState<T>> m_state;
+    SimpleThreadPool* m_pool;
+};
+
+template<typename Fnc_T>
+auto SimpleThreadPool::Submit(Fnc_T task, TaskPriority priority) -> PoolFuture<decltype(task())> {
+    using ReturnType = decltype(task());
+
+    auto state = std::make_shared<pool_detail::SharedState<ReturnType>>();
+    auto shared = std::make_shared<Fnc_T>(std::move(task));
+
+    Execute([state, shared]() { pool_detail::Fulfil(*state, *shared); }, priority);
+
+    return PoolFuture<ReturnType>(std::move(state), this);
+}
+
+/**
+ * @brief Returns a future that becomes ready once every input future is ready.
+ * The inputs are handed back, all ready, so each result (or exception) can be read without blocking.
+ */
+template <typename T>
+PoolFuture<std::vector<PoolFuture<T>>> when_all(std::vector<PoolFuture<T>> futures) {
+    SimpleThreadPool* pool = futures.empty() ? nullptr : futures.front().Pool();
+    PoolPromise<std::vector<PoolFuture<T>>> promise(pool);
+    PoolFuture<std::vector<PoolFuture<T>>> result = promise.get_future();
+
+    if (futures.empty()) {
+        promise.set_value(std::move(futures));
+        return result;
+    }
+
+    struct Context {
+        std::vector<PoolFuture<T>> futures;
+        PoolPromise<std::vector<PoolFuture<T>>> promise;
+        std::atomic<std::size_t> pending{0};
+    };
+    auto ctx = std::make_shared<Context>();
+    ctx->futures = std::move(futures);
+    ctx->promise = std::move(promise);
+
+    // One extra count held by the registration loop, so the vector is not
+    // handed out while OnReady is still being called on its elements.
+    ctx->pending.store(ctx->futures.size() + 1, std::memory_order_relaxed);
+    auto arrive = [ctx]() {
+        if (ctx->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ctx->promise.set_value(std::move(ctx->futures));
+        }
+    };
+
+    for (auto& f : ctx->futures) {
+        f.OnReady(arrive);
+    }
+    arrive();
+    return result;
+}
+
+/**
+ * @brief Result of when_any: the index of the first future to become ready, plus all inputs.
+ */
+template <typename T>
+struct WhenAnyResult {
+    std::size_t index;
+    std::vector<PoolFuture<T>> futures;
+};
+
+/**
+ * @brief Returns a future that becomes ready as soon as any input future is ready.
+ * @throws std::invalid_argument if futures is empty.
+ */
+template <typename T>
+PoolFuture<WhenAnyResult<T>> when_any(std::vector<PoolFuture<T>> futures) {
+    if (futures.empty()) {
+        throw std::invalid_argument("when_any requires at least one future");
+    }
+
+    SimpleThreadPool* pool = futures.front().Pool();
+    PoolPromise<WhenAnyResult<T>> promise(pool);
+    PoolFuture<WhenAnyResult<T>> result = promise.get_future();
+
+    struct Context {
+        std::vector<PoolFuture<T>> futures;
+        PoolPromise<WhenAnyResult<T>> promise;
+        std::atomic<bool> fired{false};
+        std::atomic<std::size_t> registered{0}; // Inputs are only handed back once all callbacks are attached
+        std::atomic<std::size_t> winner{0};
+    };
+    std::size_t count = futures.size();
+    auto ctx = std::make_shared<Context>();
+    ctx->futures = std::move(futures);
+    ctx->promise = std::move(promise);
+
+    // The winner must not move the input vector while OnReady is still being
+    // called on its elements, so the last of (winner, registration loop) to
+    // finish publishes the result.
+    auto publish = [ctx]() {
+        ctx->promise.set_value(WhenAnyResult<T>{ctx->winner.load(std::memory_order_relaxed),
+                                                std::move(ctx->futures)});
+    };
+
+    for (std::size_t i = 0; i < count; ++i) {
+        ctx->futures[i].OnReady([ctx, i, publish]() {
+            if (!ctx->fired.exchange(true, std::memory_order_acq_rel)) {
+                ctx->winner.store(i, std::memory_order_relaxed);
+                if (ctx->registered.fetch_add(1, std::memory_order_acq_rel) == 1) {
+                    publish();
+                }
+            }
+        });
+    }
+    if (ctx->registered.fetch_add(1, std::memory_order_acq_rel) == 1) {
+        publish();
+    }
+    return result;
+}
+
+#endif
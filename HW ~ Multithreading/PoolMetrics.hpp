@@ -0,0 +1,161 @@
+#ifndef POOL_METRICS_HPP
+#define POOL_METRICS_HPP
+
+#include "LatencyHistogram.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compile-time switch for SimpleThreadPool's built-in metrics. Build with
+// -DSIMPLE_THREAD_POOL_METRICS=0 to remove all recording (no clock reads, no
+// counters); snapshots then report zeros. Must be the same in every
+// translation unit that includes SimpleThreadPool.hpp.
+#ifndef SIMPLE_THREAD_POOL_METRICS
+#define SIMPLE_THREAD_POOL_METRICS 1
+#endif
+
+constexpr std::size_t kCacheLineSize = 64;
+
+/**
+ * @brief Counters of one worker slot, as seen in a snapshot.
+ */
+struct WorkerMetricsSnapshot {
+    std::size_t node = 0;
+    bool active = false;             // false once the worker retired (counts are kept)
+    std::uint64_t tasksExecuted = 0;
+    std::uint64_t tasksFailed = 0;   // Tasks that let an exception escape
+    std::uint64_t wakeups = 0;       // Returns from an idle wait
+    std::uint64_t idleWakeups = 0;   // Wakeups that found nothing to do
+    std::uint64_t spins = 0;         // Spin phases before parking
+    std::uint64_t spinHits = 0;      // Spin phases that found a task (no park, no wake needed)
+    std::uint64_t busyNanos = 0;     // Time spent running tasks
+};
+
+/**
+ * @brief Pool-wide view returned by SimpleThreadPool::GetMetrics().
+ * All counters are cumulative since the pool was created.
+ */
+struct PoolMetricsSnapshot {
+    bool enabled = SIMPLE_THREAD_POOL_METRICS != 0;
+    std::size_t threadCount = 0;
+    std::size_t queueDepth = 0;
+    std::uint64_t tasksExecuted = 0;
+    std::uint64_t tasksFailed = 0;
+    std::uint64_t wakeups = 0;
+    std::uint64_t idleWakeups = 0;
+    std::uint64_t spins = 0;
+    std::uint64_t spinHits = 0;
+    LatencyHistogram queueWait; // Enqueue-to-start, nanoseconds
+    LatencyHistogram runTime;   // Task execution time, nanoseconds
+    std::vector<WorkerMetricsSnapshot> workers;
+};
+
+#if SIMPLE_THREAD_POOL_METRICS
+
+/**
+ * @brief Metrics written by a single worker thread and read by snapshots.
+ *
+ * Each instance sits on its own cache lines so that workers never share a
+ * line they write to. Counters have a single writer, so they are bumped with
+ * a relaxed load/store pair instead of a locked read-modify-write.
+ */
+class alignas(kCacheLineSize) WorkerMetrics {
+public:
+    static constexpr bool kEnabled = true;
+
+    explicit WorkerMetrics(std::size_t node) noexcept : m_node(node) {}
+
+    void RecordWakeup(bool idle) noexcept {
+        Bump(m_wakeups, 1);
+        if (idle) {
+            Bump(m_idleWakeups, 1);
+        }
+    }
+
+    void RecordSpin(bool found) noexcept {
+        Bump(m_spins, 1);
+        if (found) {
+            Bump(m_spinHits, 1);
+        }
+    }
+
+    void RecordTask(std::uint64_t waitNanos, std::uint64_t runNanos, bool failed) noexcept {
+        Bump(m_tasksExecuted, 1);
+        if (failed) {
+            Bump(m_tasksFailed, 1);
+        }
+        Bump(m_busyNanos, runNanos);
+        m_queueWait.Record(waitNanos);
+        m_runTime.Record(runNanos);
+    }
+
+    void SetNode(std::size_t node) noexcept { m_node = node; }
+    void SetActive(bool active) noexcept { m_active.store(active, std::memory_order_relaxed); }
+    bool Active() const noexcept { return m_active.load(std::memory_order_relaxed); }
+
+    void AddTo(PoolMetricsSnapshot& snapshot) const {
+        WorkerMetricsSnapshot worker;
+        worker.node = m_node;
+        worker.active = Active();
+        worker.tasksExecuted = m_tasksExecuted.load(std::memory_order_relaxed);
+        worker.tasksFailed = m_tasksFailed.load(std::memory_order_relaxed);
+        worker.wakeups = m_wakeups.load(std::memory_order_relaxed);
+        worker.idleWakeups = m_idleWakeups.load(std::memory_order_relaxed);
+        worker.spins = m_spins.load(std::memory_order_relaxed);
+        worker.spinHits = m_spinHits.load(std::memory_order_relaxed);
+        worker.busyNanos = m_busyNanos.load(std::memory_order_relaxed);
+
+        snapshot.tasksExecuted += worker.tasksExecuted;
+        snapshot.tasksFailed += worker.tasksFailed;
+        snapshot.wakeups += worker.wakeups;
+        snapshot.idleWakeups += worker.idleWakeups;
+        snapshot.spins += worker.spins;
+        snapshot.spinHits += worker.spinHits;
+        snapshot.queueWait.Merge(m_queueWait);
+        snapshot.runTime.Merge(m_runTime);
+        snapshot.workers.push_back(worker);
+    }
+
+private:
+    static void Bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::size_t m_node;
+    std::atomic<bool> m_active{true};
+    std::atomic<std::uint64_t> m_tasksExecuted{0};
+    std::atomic<std::uint64_t> m_tasksFailed{0};
+    std::atomic<std::uint64_t> m_wakeups{0};
+    std::atomic<std::uint64_t> m_idleWakeups{0};
+    std::atomic<std::uint64_t> m_spins{0};
+    std::atomic<std::uint64_t> m_spinHits{0};
+    std::atomic<std::uint64_t> m_busyNanos{0};
+    LatencyHistogram m_queueWait;
+    LatencyHistogram m_runTime;
+};
+
+#else
+
+// Metrics compiled out: every call is an empty inline function.
+class WorkerMetrics {
+public:
+    static constexpr bool kEnabled = false;
+
+    explicit WorkerMetrics(std::size_t) noexcept {}
+    void RecordWakeup(bool) noexcept {}
+    void RecordSpin(bool) noexcept {}
+    void RecordTask(std::uint64_t, std::uint64_t, bool) noexcept {}
+    void SetNode(std::size_t) noexcept {}
+    void SetActive(bool active) noexcept { m_active = active; }
+    bool Active() const noexcept { return m_active; }
+    void AddTo(PoolMetricsSnapshot&) const {}
+
+private:
+    bool m_active = true;
+};
+
+#endif
+
+#endif
@@ -1,17 +1,109 @@
 #include "SimpleThreadPool.hpp"
+#include <algorithm> // For the deadline heap
 #include <iostream> // For limited status messages (optional)
+#include <system_error>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace {
+// The pool whose worker is running on this thread (nullptr elsewhere), and its node group.
+thread_local SimpleThreadPool* t_workerPool = nullptr;
+thread_local std::size_t t_workerNode = 0;
+thread_local WorkerMetrics* t_workerMetrics = nullptr;
+
+// Restricts the calling thread to the given CPUs. Best effort: failures (e.g.
+// CPUs outside the container's cpuset) leave the thread unpinned.
+void PinCurrentThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+
+// Tells the CPU we are in a spin-wait loop (saves power, frees the core's
+// resources for a sibling hyperthread).
+inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+    __asm__ __volatile__("yield");
+#endif
+}
+
+int CurrentCpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+}
 
 SimpleThreadPool::SimpleThreadPool(std::size_t threadCount) :
-    m_threadCount(threadCount), stop(false)
+    SimpleThreadPool(ThreadPoolOptions{threadCount})
 {
-    if (threadCount == 0) {
+}
+
+SimpleThreadPool::SimpleThreadPool(const ThreadPoolOptions& options) :
+    m_threadCount(options.threadCount), m_starvationLimit(options.starvationLimit),
+    m_minThreads(options.minThreads == 0 ? options.threadCount : std::min(options.minThreads, options.threadCount)),
+    m_maxThreads(std::max(options.maxThreads, options.threadCount)),
+    m_growQueueDepth(options.growQueueDepth),
+    m_growWaitThreshold(options.growWaitThreshold),
+    m_idleTimeout(options.idleTimeout),
+    m_placement(options.placement),
+    m_spinTime(std::thread::hardware_concurrency() > 1 ? options.spinTime : std::chrono::microseconds(0)),
+    m_yieldCount(options.yieldCount),
+    m_fullPolicy(options.fullPolicy),
+    stop(false)
+{
+    if (options.queue == QueueBackend::LockFreeRing) {
+        ring = std::make_unique<BoundedMpmcQueue<Job>>(options.ringCapacity);
+    }
+
+    // One queue group per NUMA node when requested, a single group otherwise.
+    if (m_placement != WorkerPlacement::None) {
+        m_topology = CpuTopology::Detect();
+    }
+    std::size_t groupCount = (m_placement == WorkerPlacement::NumaNodes) ? m_topology.NodeCount() : 1;
+    for (std::size_t node = 0; node < groupCount; ++node) {
+        auto queue = std::make_unique<NodeQueue>();
+        if (m_placement == WorkerPlacement::NumaNodes) {
+            queue->cpus = m_topology.Nodes()[node].cpus;
+            queue->stealOrder = m_topology.NodesByDistance(node);
+        }
+        nodes.push_back(std::move(queue));
+    }
+
+    if (m_threadCount == 0 && m_maxThreads == 0) {
          std::cerr << "Warning: Creating SimpleThreadPool with 0 threads." << std::endl;
          // Or throw std::invalid_argument("Thread count must be positive.");
          return; // Or proceed, depending on desired behavior
     }
-    threads.reserve(m_threadCount);
+    threads.reserve(m_maxThreads);
+    std::lock_guard<std::mutex> lock(mut); // Workers may already call RetireLocked()
     for (size_t i = 0; i < m_threadCount; ++i) {
-        threads.emplace_back(&SimpleThreadPool::WorkOn, this);
+        StartWorkerLocked(kAnyNode);
     }
     // std::cout << "SimpleThreadPool created with " << m_threadCount << " threads." << std::endl;
 }
@@ -26,7 +118,23 @@ SimpleThreadPool::~SimpleThreadPool() {
 
 void SimpleThreadPool::Destroy() {
     // Use a simple lock and check mechanism for setting the stop flag.
+    // The worker list is taken out under the same lock: once stop is set no
+    // worker is started or retired any more, so nothing else touches it.
     bool already_stopping = false;
+    std::vector<std::thread> workers;
+
+    // Turn away new ring pushes and wait for those already in flight, so that
+    // every task accepted into the ring is still drained by the workers.
+    stopRequested.store(true, std::memory_order_seq_cst);
+    if (ring) {
+        {
+            std::lock_guard<std::mutex> lock(spaceMut);
+        }
+        spaceCondition.notify_all(); // Blocked producers give up
+        while (ringProducers.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
     {
         std::unique_lock<std::mutex> lock(mut);
         if (stop) {
@@ -34,6 +142,13 @@ void SimpleThreadPool::Destroy() {
         } else {
             stop = true; // Signal threads to stop
         }
+        workers = std::move(threads);
+        threads.clear();
+        for (std::thread& worker : retired) {
+            workers.push_back(std::move(worker));
+        }
+        retired.clear();
+        UpdateLiveWorkersLocked();
     } // Release lock before potentially long operations (notify, join)
 
     if (already_stopping) {
@@ -43,56 +158,593 @@ void SimpleThreadPool::Destroy() {
     } else {
         // std::cout << "Stopping thread pool..." << std::endl;
         // Notify all waiting threads to wake up and check the stop flag.
-        condition.notify_all();
+        for (auto& queue : nodes) {
+            queue->condition.notify_all();
+        }
     }
 
 
     // Wait for all worker threads to finish execution.
-    for (std::thread& worker : threads) {
+    for (std::thread& worker : workers) {
         if (worker.joinable()) {
             // std::cout << "Joining thread " << worker.get_id() << std::endl;
             worker.join();
         }
     }
-    threads.clear(); // Optional: clear the vector after joining
     // std::cout << "All threads joined." << std::endl;
 }
 
+std::size_t SimpleThreadPool::ThreadCount() const {
+    std::lock_guard<std::mutex> lock(mut);
+    return threads.size();
+}
+
+PoolMetricsSnapshot SimpleThreadPool::GetMetrics() const {
+    PoolMetricsSnapshot snapshot;
+    snapshot.queueDepth = queueDepth.load(std::memory_order_relaxed) + (ring ? ring->SizeApprox() : 0);
+
+    std::lock_guard<std::mutex> lock(metricsMut);
+    for (const auto& metrics : workerMetrics) {
+        metrics->AddTo(snapshot);
+        if (metrics->Active()) {
+            ++snapshot.threadCount;
+        }
+    }
+    return snapshot;
+}
+
+WorkerMetrics* SimpleThreadPool::AcquireMetrics(std::size_t node) {
+    std::lock_guard<std::mutex> lock(metricsMut);
+    // Reuse the slot of a retired worker so that the history is kept but the
+    // slot count stays bounded by the peak number of workers.
+    for (auto& metrics : workerMetrics) {
+        if (!metrics->Active()) {
+            metrics->SetActive(true);
+            metrics->SetNode(node);
+            return metrics.get();
+        }
+    }
+    workerMetrics.push_back(std::make_unique<WorkerMetrics>(node));
+    return workerMetrics.back().get();
+}
+
+void SimpleThreadPool::ReleaseMetrics(WorkerMetrics* metrics) {
+    std::lock_guard<std::mutex> lock(metricsMut);
+    metrics->SetActive(false);
+}
+
+std::size_t SimpleThreadPool::CurrentNode() const noexcept {
+    return t_workerPool == this ? t_workerNode : nodes.size();
+}
+
+void SimpleThreadPool::BeginBlocking() {
+    if (t_workerPool != this) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mut);
+    ++blockedWorkers;
+    UpdateLiveWorkersLocked();
+    if (HasWorkLocked()) {
+        GrowLocked(t_workerNode);
+    }
+}
+
+void SimpleThreadPool::EndBlocking() {
+    if (t_workerPool != this) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mut);
+    --blockedWorkers;
+    UpdateLiveWorkersLocked();
+    // Surplus workers started to compensate retire through the idle timeout.
+}
+
+void SimpleThreadPool::StartWorkerLocked(std::size_t node) {
+    if (node == kAnyNode) {
+        // Spread workers over the groups in proportion to their CPU counts.
+        node = 0;
+        auto cpuCount = [this](std::size_t i) { return nodes[i]->cpus.empty() ? 1 : nodes[i]->cpus.size(); };
+        for (std::size_t i = 1; i < nodes.size(); ++i) {
+            // workers[i] / cpus[i] < workers[node] / cpus[node], without division
+            if (nodes[i]->workerCount * cpuCount(node) < nodes[node]->workerCount * cpuCount(i)) {
+                node = i;
+            }
+        }
+    }
+
+    int cpu = -1;
+    if (m_placement == WorkerPlacement::PinToCores) {
+        std::vector<int> cpus = m_topology.Cpus();
+        cpu = cpus[m_nextCpu++ % cpus.size()];
+    }
+
+    threads.emplace_back(&SimpleThreadPool::WorkOn, this, node, cpu);
+    ++nodes[node]->workerCount;
+    UpdateLiveWorkersLocked();
+}
+
+void SimpleThreadPool::GrowLocked(std::size_t node) {
+    if (stop || idleWorkers != 0 || threads.size() - blockedWorkers >= m_maxThreads) {
+        return;
+    }
+    try {
+        StartWorkerLocked(node);
+    } catch (const std::system_error& e) {
+        // Out of threads: keep going with the workers we have.
+        std::cerr << "Warning: SimpleThreadPool could not start a worker: " << e.what() << std::endl;
+    }
+}
+
+void SimpleThreadPool::RetireLocked(std::size_t node) {
+    // Join the previously retired worker (it no longer needs the lock, so this
+    // cannot deadlock) and leave this one for the next retirement or Destroy().
+    for (std::thread& worker : retired) {
+        worker.join();
+    }
+    retired.clear();
+
+    auto self = std::find_if(threads.begin(), threads.end(),
+                             [](const std::thread& t) { return t.get_id() == std::this_thread::get_id(); });
+    if (self != threads.end()) {
+        retired.push_back(std::move(*self));
+        threads.erase(self);
+    }
+    --nodes[node]->workerCount;
+    UpdateLiveWorkersLocked();
+}
+
+void SimpleThreadPool::Enqueue(Job job, QueueLane lane, std::size_t node) {
+    if (ring && lane == QueueLane::Normal && node == kAnyNode) {
+        PushToRing(std::move(job));
+        return;
+    }
+
+    job.enqueued = Clock::now();
+    std::condition_variable* wake = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mut);
+
+        // Prevent enqueueing tasks after the pool has been signaled to stop.
+        if (stop) {
+            throw std::runtime_error("Post on stopped SimpleThreadPool");
+        }
+
+        // Without a hint, keep the task close to the submitter: a worker's own
+        // group, or the group of the CPU an outside thread is running on.
+        if (node == kAnyNode) {
+            if (t_workerPool == this) {
+                node = t_workerNode;
+            } else if (nodes.size() > 1) {
+                int cpu = CurrentCpu();
+                node = cpu < 0 ? 0 : m_topology.NodeOfCpu(cpu);
+            } else {
+                node = 0;
+            }
+        }
+        NodeQueue& queue = *nodes[node % nodes.size()];
+
+        if (lane == QueueLane::Deadline) {
+            queue.deadlineTasks.push_back(std::move(job));
+            std::push_heap(queue.deadlineTasks.begin(), queue.deadlineTasks.end(), DeadlineLater{});
+        } else {
+            queue.tasks[static_cast<std::size_t>(lane) - 1].push_back(std::move(job));
+        }
+        ++queue.queuedCount;
+        ++queuedCount;
+        queueDepth.store(queuedCount, std::memory_order_relaxed);
+
+        // Grow on a deep queue, or when no worker could pick the task up at all.
+        if (queuedCount + (ring ? ring->SizeApprox() : 0) > m_growQueueDepth || threads.size() == blockedWorkers) {
+            GrowLocked(node % nodes.size());
+        }
+
+        // Every spinning worker takes a task (from any group) once it stops
+        // spinning, so no wake is needed while they cover the queue.
+        // Otherwise wake an idle worker of the target group, or else the
+        // nearest group with an idle worker so that it can steal the task.
+        if (queuedCount <= spinningWorkers) {
+            wake = nullptr;
+        } else if (queue.idleWorkers != 0) {
+            wake = &queue.condition;
+        } else {
+            for (std::size_t other : queue.stealOrder) {
+                if (nodes[other]->idleWorkers != 0) {
+                    wake = &nodes[other]->condition;
+                    break;
+                }
+            }
+        }
+    } // Mutex lock released here
+
+    // Notify one waiting worker thread that a new task is available.
+    if (wake != nullptr) {
+        wake->notify_one();
+    }
+}
+
+void SimpleThreadPool::PushToRing(Job job) {
+    // Counted while in flight, see Destroy(). Checking stopRequested after the
+    // increment (both seq_cst) means either Destroy() waits for this push or
+    // this push sees the stop.
+    struct InFlight {
+        std::atomic<std::size_t>& count;
+        explicit InFlight(std::atomic<std::size_t>& c) : count(c) { count.fetch_add(1, std::memory_order_seq_cst); }
+        ~InFlight() { count.fetch_sub(1, std::memory_order_seq_cst); }
+    } inFlight(ringProducers);
+
+    job.enqueued = Clock::now();
+    for (std::uint32_t attempt = 0;; ++attempt) {
+        if (stopRequested.load(std::memory_order_seq_cst)) {
+            throw std::runtime_error("Post on stopped SimpleThreadPool");
+        }
+        if (ring->TryPush(std::move(job))) {
+            break;
+        }
+
+        if (m_fullPolicy == QueueFullPolicy::FailFast) {
+            throw QueueFullError("SimpleThreadPool queue is full");
+        } else if (m_fullPolicy == QueueFullPolicy::Spin || t_workerPool == this) {
+            // A worker must not sleep here: if every worker did, nobody would
+            // free a slot. It runs a queued task instead.
+            if (t_workerPool == this && RunPendingTask()) {
+                continue;
+            }
+            if (attempt < 64) {
+                CpuRelax();
+            } else {
+                std::this_thread::yield();
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(spaceMut);
+            blockedProducers.fetch_add(1, std::memory_order_seq_cst);
+            spaceCondition.wait(lock, [this] {
+                return ring->SizeApprox() < ring->Capacity() || stopRequested.load(std::memory_order_relaxed);
+            });
+            blockedProducers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Pairs with the fence in WorkOn() before a worker parks: either it sees
+    // this task, or we see it parked and wake it under mut.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool parked = parkedWorkers.load(std::memory_order_relaxed) != 0;
+    bool grow = m_maxThreads > m_minThreads &&
+                (liveWorkers.load(std::memory_order_relaxed) == 0 ||
+                 (!parked && ring->SizeApprox() > m_growQueueDepth));
+    if (!parked && !grow) {
+        return;
+    }
+
+    std::condition_variable* wake = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        std::size_t node = t_workerPool == this ? t_workerNode : 0;
+        if (grow) {
+            GrowLocked(node);
+        }
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            NodeQueue& queue = *nodes[(node + i) % nodes.size()];
+            if (queue.idleWorkers != 0) {
+                wake = &queue.condition;
+                break;
+            }
+        }
+    }
+    if (wake != nullptr) {
+        wake->notify_one();
+    }
+}
+
+bool SimpleThreadPool::PopFromRing(Job& job, std::chrono::nanoseconds& waited) {
+    if (!ring->TryPop(job)) {
+        return false;
+    }
+    OnRingSpace();
+    waited = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - job.enqueued);
+    ringDispatched.fetch_add(1, std::memory_order_relaxed);
+    if constexpr (WorkerMetrics::kEnabled) {
+        laneStats[static_cast<std::size_t>(QueueLane::Normal)].wait.Record(static_cast<std::uint64_t>(waited.count()));
+    }
+    return true;
+}
+
+void SimpleThreadPool::OnRingSpace() {
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with blockedProducers' increment
+    if (blockedProducers.load(std::memory_order_relaxed) != 0) {
+        {
+            std::lock_guard<std::mutex> lock(spaceMut);
+        }
+        spaceCondition.notify_all();
+    }
+}
+
+bool SimpleThreadPool::HasWorkLocked() const {
+    return queuedCount != 0 || RingHasWork();
+}
+
+bool SimpleThreadPool::PopNextLocked(std::size_t node, Job& job, std::chrono::nanoseconds& waited) {
+    // Own group (the ring counts as every group's Normal lane) first, then
+    // steal from the other groups, nearest first.
+    NodeQueue& home = *nodes[node];
+    if (home.queuedCount != 0 || RingHasWork()) {
+        return PopFromLocked(home, job, waited);
+    }
+    for (std::size_t other : home.stealOrder) {
+        if (nodes[other]->queuedCount != 0) {
+            return PopFromLocked(*nodes[other], job, waited);
+        }
+    }
+    return false;
+}
+
+bool SimpleThreadPool::PopFromLocked(NodeQueue& queue, Job& job, std::chrono::nanoseconds& waited) {
+    constexpr std::size_t kNormal = static_cast<std::size_t>(QueueLane::Normal);
+    auto laneEmpty = [this, &queue](std::size_t lane) {
+        if (lane == 0) {
+            return queue.deadlineTasks.empty();
+        }
+        return queue.tasks[lane - 1].empty() && !(lane == kNormal && RingHasWork());
+    };
 
-void SimpleThreadPool::WorkOn() {
+    // Most urgent non-empty lane first...
+    std::size_t chosen = kQueueLaneCount;
+    for (std::size_t lane = 0; lane < kQueueLaneCount; ++lane) {
+        if (!laneEmpty(lane)) {
+            chosen = lane;
+            break;
+        }
+    }
+    if (chosen == kQueueLaneCount) {
+        return false;
+    }
+
+    // ...unless a less urgent lane has been passed over too often, in which
+    // case the least urgent such lane gets this dispatch.
+    bool promoted = false;
+    for (std::size_t lane = kQueueLaneCount - 1; lane > chosen; --lane) {
+        if (!laneEmpty(lane) && queue.passedOver[lane] >= m_starvationLimit) {
+            chosen = lane;
+            promoted = true;
+            break;
+        }
+    }
+
+    bool fromRing = false;
+    if (chosen == 0) {
+        std::pop_heap(queue.deadlineTasks.begin(), queue.deadlineTasks.end(), DeadlineLater{});
+        job = std::move(queue.deadlineTasks.back());
+        queue.deadlineTasks.pop_back();
+    } else if (chosen == kNormal && queue.tasks[chosen - 1].empty()) {
+        // The ring looked non-empty, but a lock-free consumer may have won the race.
+        if (!ring->TryPop(job)) {
+            return false;
+        }
+        OnRingSpace();
+        fromRing = true;
+    } else {
+        job = std::move(queue.tasks[chosen - 1].front());
+        queue.tasks[chosen - 1].pop_front();
+    }
+    if (!fromRing) {
+        --queue.queuedCount;
+        --queuedCount;
+        queueDepth.store(queuedCount, std::memory_order_relaxed);
+    }
+
+    queue.passedOver[chosen] = 0;
+    for (std::size_t lane = chosen + 1; lane < kQueueLaneCount; ++lane) {
+        if (!laneEmpty(lane)) {
+            ++queue.passedOver[lane];
+        }
+    }
+
+    LaneStats& stats = laneStats[chosen];
+    ++stats.dispatched;
+    if (promoted) {
+        ++stats.promoted;
+    }
+    waited = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - job.enqueued);
+    if constexpr (WorkerMetrics::kEnabled) {
+        stats.wait.Record(static_cast<std::uint64_t>(waited.count()));
+    }
+    return true;
+}
+
+LaneStats SimpleThreadPool::GetLaneStats(QueueLane lane) const {
+    std::size_t index = static_cast<std::size_t>(lane);
+
+    std::lock_guard<std::mutex> lock(mut);
+    LaneStats snapshot = laneStats[index];
+    for (const auto& queue : nodes) {
+        snapshot.queued += (index == 0) ? queue->deadlineTasks.size() : queue->tasks[index - 1].size();
+    }
+    if (ring && lane == QueueLane::Normal) {
+        snapshot.queued += ring->SizeApprox();
+        snapshot.dispatched += ringDispatched.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void SimpleThreadPool::ResetLaneStats() {
+    std::lock_guard<std::mutex> lock(mut);
+    for (LaneStats& stats : laneStats) {
+        stats.dispatched = 0;
+        stats.promoted = 0;
+        stats.wait.Reset();
+    }
+    ringDispatched.store(0, std::memory_order_relaxed);
+}
+
+bool SimpleThreadPool::SpinForWork() const {
+    auto hasWork = [this] { return queueDepth.load(std::memory_order_relaxed) != 0 || RingHasWork(); };
+
+    if (m_spinTime.count() != 0) {
+        auto until = Clock::now() + m_spinTime;
+        for (std::uint32_t i = 1;; ++i) {
+            if (hasWork()) {
+                return true;
+            }
+            CpuRelax();
+            // Reading the clock costs more than a pause, so only check now and then.
+            if (i % 64 == 0 && Clock::now() >= until) {
+                break;
+            }
+        }
+    }
+    for (std::uint32_t i = 0; i < m_yieldCount; ++i) {
+        if (hasWork()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    return hasWork();
+}
+
+void SimpleThreadPool::WorkOn(std::size_t node, int cpu) {
     // std::cout << "Worker thread " << std::this_thread::get_id() << " started." << std::endl;
+    t_workerPool = this;
+    t_workerNode = node;
+    if (cpu >= 0) {
+        PinCurrentThread({cpu});
+    } else {
+        PinCurrentThread(nodes[node]->cpus); // Whole node (empty = no pinning)
+    }
+
+    // The slot is handed back on every exit path, after mut has been released.
+    struct MetricsSlot {
+        SimpleThreadPool* pool;
+        WorkerMetrics* metrics;
+        ~MetricsSlot() { pool->ReleaseMetrics(metrics); }
+    } slot{this, AcquireMetrics(node)};
+    WorkerMetrics& metrics = *slot.metrics;
+    t_workerMetrics = slot.metrics;
+
     while (true) {
-        std::function<void()> task;
+        Job task;
+        std::chrono::nanoseconds waited{};
+
+        // Lock-free fast path: while the mutex lanes are empty there is nothing
+        // more urgent than the ring, so take from it without mut.
+        if (ring && queueDepth.load(std::memory_order_relaxed) == 0 && PopFromRing(task, waited)) {
+            RunJob(task, waited);
+            continue;
+        }
+
         {
             std::unique_lock<std::mutex> lock(mut);
+            NodeQueue& home = *nodes[node];
 
-            condition.wait(lock, [this] { return stop || !tasks.empty(); });
+            // Wait for work. Workers above the minimum give up after the idle timeout.
+            bool retire = false;
+            ++idleWorkers;
+            ++home.idleWorkers;
+
+            // Spin, then yield, before parking. The spinner is counted (under
+            // mut) so that Enqueue can skip the wake; it re-checks the queue
+            // under mut afterwards, so a task posted meanwhile is never missed.
+            if (!stop && !HasWorkLocked() && (m_spinTime.count() != 0 || m_yieldCount != 0)) {
+                ++spinningWorkers;
+                lock.unlock();
+                bool found = SpinForWork();
+                lock.lock();
+                --spinningWorkers;
+                metrics.RecordSpin(found);
+            }
+
+            while (!stop && !HasWorkLocked()) {
+                // Ring producers do not take mut, so announce the park and look
+                // at the ring once more (pairs with the fence in PushToRing()).
+                parkedWorkers.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                bool timedOut = false;
+                if (!RingHasWork()) {
+                    if (threads.size() <= m_minThreads) {
+                        home.condition.wait(lock);
+                    } else {
+                        timedOut = home.condition.wait_for(lock, m_idleTimeout) == std::cv_status::timeout;
+                    }
+                }
+                parkedWorkers.fetch_sub(1, std::memory_order_relaxed);
+
+                if (timedOut && !stop && !HasWorkLocked() && threads.size() > m_minThreads) {
+                    retire = true;
+                    break;
+                }
+                metrics.RecordWakeup(!stop && !HasWorkLocked());
+            }
+            --idleWorkers;
+            --home.idleWorkers;
+
+            if (retire) {
+                RetireLocked(node);
+                return;
+            }
 
             // If stop is signaled and the queue is empty, the thread can exit.
-            if (stop && tasks.empty()) {
+            if (stop && !HasWorkLocked()) {
                 // std::cout << "Worker thread " << std::this_thread::get_id() << " stopping." << std::endl;
                 return;
             }
 
             // Check if a task is available (could have been woken by stop, but tasks remain)
-            if (!tasks.empty()) {
-                task = std::move(tasks.front()); // Move task out of queue
-                tasks.pop();
-            } else {
+            if (!PopNextLocked(node, task, waited)) {
                 // Spurious wake or woken by stop signal but tasks remain, loop again
                 continue;
             }
 
+            // Tasks are waiting too long: add a worker if allowed.
+            if (HasWorkLocked() && waited > m_growWaitThreshold) {
+                GrowLocked(node);
+            }
+
         } // Release lock before executing the task
 
         // Execute the task outside the lock to allow other threads to proceed.
-        try {
-            task();
-        } catch (const std::exception& e) {
-            std::cerr << "Thread " << std::this_thread::get_id() << " caught exception: " << e.what() << std::endl;
-            // Log and continue is a common strategy for thread pools.
-        } catch (...) {
-            std::cerr << "Thread " << std::this_thread::get_id() << " caught unknown exception." << std::endl;
+        RunJob(task, waited);
+    }
+}
+
+bool SimpleThreadPool::RunPendingTask() {
+    Job task;
+    std::chrono::nanoseconds waited{};
+    if (ring && queueDepth.load(std::memory_order_relaxed) == 0 && PopFromRing(task, waited)) {
+        RunJob(task, waited);
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        std::size_t node = t_workerPool == this ? t_workerNode : 0;
+        if (!HasWorkLocked() || !PopNextLocked(node, task, waited)) {
+            return false;
+        }
+    }
+    RunJob(task, waited);
+    return true;
+}
+
+void SimpleThreadPool::RunJob(Job& task, std::chrono::nanoseconds waited) {
+    // Only this pool's workers have a metrics slot; helping outside threads are not counted.
+    WorkerMetrics* metrics = t_workerPool == this ? t_workerMetrics : nullptr;
+
+    Clock::time_point started;
+    if constexpr (WorkerMetrics::kEnabled) {
+        started = Clock::now();
+    }
+    bool failed = false;
+    try {
+        task();
+    } catch (const std::exception& e) {
+        failed = true;
+        std::cerr << "Thread " << std::this_thread::get_id() << " caught exception: " << e.what() << std::endl;
+        // Log and continue is a common strategy for thread pools.
+    } catch (...) {
+        failed = true;
+        std::cerr << "Thread " << std::this_thread::get_id() << " caught unknown exception." << std::endl;
+    }
+    if constexpr (WorkerMetrics::kEnabled) {
+        if (metrics != nullptr) {
+            auto ran = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started);
+            metrics->RecordTask(static_cast<std::uint64_t>(waited.count()), static_cast<std::uint64_t>(ran.count()), failed);
         }
     }
-}
\ No newline at end of file
+}
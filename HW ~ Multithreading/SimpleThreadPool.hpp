@@ -2,7 +2,11 @@
 #define SIMPLE_THREAD_POOL_HPP
 
 #include <vector>
-#include <queue>
+#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -13,9 +17,137 @@
 #include <utility>
 #include <cstddef>   
 
+#include "CpuTopology.hpp"
+#include "LatencyHistogram.hpp"
+#include "MpmcQueue.hpp"
+#include "PoolMetrics.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define SIMPLE_THREAD_POOL_HAS_COROUTINES 1
+#endif
+
+template <typename T>
+class PoolFuture; // Defined in PoolFuture.hpp
+
+/**
+ * @brief Scheduling class chosen per task. Higher classes are dequeued first.
+ */
+enum class TaskPriority : std::uint8_t {
+    High,
+    Normal,
+    Low
+};
+
+/**
+ * @brief The queues a task can wait in. Tasks posted with a deadline go to the
+ * Deadline lane (earliest deadline first), which is served before the others.
+ */
+enum class QueueLane : std::uint8_t {
+    Deadline,
+    High,
+    Normal,
+    Low
+};
+
+constexpr std::size_t kQueueLaneCount = 4;
+
+/**
+ * @brief Where worker threads run.
+ */
+enum class WorkerPlacement : std::uint8_t {
+    None,       // Let the OS schedule workers anywhere
+    PinToCores, // Pin each worker to a single online CPU, round-robin in node order
+    NumaNodes   // One worker group and one queue per NUMA node; workers are pinned to their node's CPUs
+};
+
+/**
+ * @brief Storage for queued tasks.
+ */
+enum class QueueBackend : std::uint8_t {
+    Locked,      // Every lane is a std::deque guarded by the pool mutex
+    LockFreeRing // Normal-priority tasks without a node hint go through a bounded lock-free ring
+};
+
+/**
+ * @brief What a producer does when the lock-free ring is full.
+ */
+enum class QueueFullPolicy : std::uint8_t {
+    Block,   // Sleep until a worker frees a slot (a worker posting runs queued tasks instead)
+    Spin,    // Busy-wait, then yield, until a slot frees up
+    FailFast // Throw QueueFullError
+};
+
+/**
+ * @brief Thrown by the posting functions under QueueFullPolicy::FailFast when the ring is full.
+ */
+class QueueFullError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Construction parameters for SimpleThreadPool.
+ */
+struct ThreadPoolOptions {
+    std::size_t threadCount = 4;
+    // Starvation guard: a non-empty lane that has been passed over this many
+    // times in favour of more urgent lanes is served next.
+    std::uint32_t starvationLimit = 32;
+
+    // Elastic sizing. The pool starts with threadCount workers and stays within
+    // [minThreads, maxThreads]; 0 means "same as threadCount", so by default
+    // the size is fixed. Workers blocked in a BlockingScope do not count
+    // towards maxThreads.
+    std::size_t minThreads = 0;
+    std::size_t maxThreads = 0;
+    // A worker is added when none is idle and more than growQueueDepth tasks
+    // are queued, or when a task is dequeued after waiting longer than
+    // growWaitThreshold while others are still queued.
+    std::size_t growQueueDepth = 8;
+    std::chrono::milliseconds growWaitThreshold{10};
+    // Workers above minThreads exit after being idle this long.
+    std::chrono::milliseconds idleTimeout{2000};
+
+    // Worker placement. The topology is read from sysfs on Linux; pinning is
+    // a no-op on other platforms.
+    WorkerPlacement placement = WorkerPlacement::None;
+
+    // Idle strategy. A worker that runs out of tasks busy-waits (with a CPU
+    // pause hint) for up to spinTime, then yields its time slice yieldCount
+    // times, and only then parks. While a worker spins, posting does not need
+    // to wake anyone. Lower both for power-conscious deployments (0 and 0
+    // parks immediately), raise spinTime for latency-critical ones. Spinning
+    // is skipped on single-CPU machines, where it only delays the poster.
+    std::chrono::microseconds spinTime{20};
+    std::uint32_t yieldCount = 4;
+
+    // Queue backend. With LockFreeRing, Normal-priority tasks posted without a
+    // node hint skip the pool mutex on both ends: they go through a bounded
+    // MPMC ring of ringCapacity slots (rounded up to a power of two), shared by
+    // all node groups and served as the Normal lane. Other lanes, node-hinted
+    // posts and the bookkeeping stay on the mutex.
+    QueueBackend queue = QueueBackend::Locked;
+    std::size_t ringCapacity = 4096;
+    QueueFullPolicy fullPolicy = QueueFullPolicy::Block;
+};
+
+/**
+ * @brief Queue statistics of a single lane.
+ */
+struct LaneStats {
+    std::size_t queued = 0;      // Tasks currently waiting
+    std::uint64_t dispatched = 0; // Tasks handed to a worker so far
+    std::uint64_t promoted = 0;   // Dispatches forced by the starvation guard
+    LatencyHistogram wait;        // Enqueue-to-dispatch time, in nanoseconds
+};
+
 class SimpleThreadPool {
 public:
+    using Clock = std::chrono::steady_clock;
+
     explicit SimpleThreadPool(std::size_t threadCount);
+    explicit SimpleThreadPool(const ThreadPoolOptions& options);
     ~SimpleThreadPool();
 
     // Non-copyable and non-movable
@@ -28,49 +160,313 @@ public:
      * @brief Submits a task for execution by a worker thread.
      * @tparam Fnc_T The type of the callable task.
      * @param task The callable task (function, lambda, functor).
+     * @param priority The lane the task waits in; tasks in the same lane run in FIFO order.
      * @return std::future<ReturnType> A future associated with the task's result.
      * @throws std::runtime_error if called after the pool has been stopped.
+     * @throws QueueFullError if the ring is full under QueueFullPolicy::FailFast
+     *         (the same applies to every posting function below).
+     */
+    template<typename Fnc_T>
+    auto Post(Fnc_T task, TaskPriority priority = TaskPriority::Normal) -> std::future<decltype(task())> {
+        std::future<decltype(task())> future;
+        Enqueue(Package(std::move(task), future), LaneOf(priority));
+        return future;
+    }
+
+    /**
+     * @brief Submits a task to the deadline lane, ordered earliest-deadline-first.
+     * The deadline only orders the queue; a task that misses it still runs.
+     * @throws std::runtime_error if called after the pool has been stopped.
+     */
+    template<typename Fnc_T>
+    auto Post(Fnc_T task, Clock::time_point deadline) -> std::future<decltype(task())> {
+        std::future<decltype(task())> future;
+        Job job = Package(std::move(task), future);
+        job.deadline = deadline;
+        Enqueue(std::move(job), QueueLane::Deadline);
+        return future;
+    }
+
+    /**
+     * @brief Submits a task to the queue of a given NUMA node group.
+     * Workers of that node run it unless they are all busy and another node steals it.
+     * @param node Node group index in [0, NodeCount()); taken modulo NodeCount().
+     * @throws std::runtime_error if called after the pool has been stopped.
+     */
+    template<typename Fnc_T>
+    auto PostOnNode(std::size_t node, Fnc_T task, TaskPriority priority = TaskPriority::Normal)
+        -> std::future<decltype(task())> {
+        std::future<decltype(task())> future;
+        Enqueue(Package(std::move(task), future), LaneOf(priority), node);
+        return future;
+    }
+
+    /**
+     * @brief Submits a task without creating a future for it (fire-and-forget).
+     * Exceptions escaping the task are caught and logged by the worker.
+     * @throws std::runtime_error if called after the pool has been stopped.
+     */
+    template<typename Fnc_T>
+    void Execute(Fnc_T task, TaskPriority priority = TaskPriority::Normal) {
+        Enqueue(Job{std::function<void()>(std::move(task))}, LaneOf(priority));
+    }
+
+    /**
+     * @brief Submits a task and returns a PoolFuture supporting non-blocking continuations.
+     * Defined in PoolFuture.hpp, which must be included to use it.
+     * @throws std::runtime_error if called after the pool has been stopped.
+     */
+    template<typename Fnc_T>
+    auto Submit(Fnc_T task, TaskPriority priority = TaskPriority::Normal) -> PoolFuture<decltype(task())>;
+
+
+    void Destroy();
+
+    /**
+     * @brief Takes one queued task (the caller's node group first) and runs it on the calling thread.
+     * Exceptions escaping the task are caught and logged, as on a worker.
+     * @return false if no task was queued.
+     */
+    bool RunPendingTask();
+
+    // How long Wait() and TaskGroup::Wait() block before looking for queued work again.
+    static constexpr std::chrono::microseconds kHelpPollInterval{100};
+
+    /**
+     * @brief Waits for a future while running queued tasks on the calling thread.
+     * Safe to call from inside a worker: the waiting worker keeps draining the
+     * queue (including the subtasks it waits for), so nested waits cannot
+     * starve a fixed-size pool.
+     * @param future Anything with std::future's wait_for() (std::future,
+     *        std::shared_future, PoolFuture). Its value is left in place.
+     */
+    template<typename Future>
+    void Wait(const Future& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!RunPendingTask()) {
+                future.wait_for(kHelpPollInterval);
+            }
+        }
+    }
+
+    /**
+     * @brief Number of worker threads owned by the pool (0 after Destroy()).
+     */
+    std::size_t ThreadCount() const;
+
+    /**
+     * @brief Number of node groups (1 unless placement is WorkerPlacement::NumaNodes).
+     */
+    std::size_t NodeCount() const noexcept { return nodes.size(); }
+
+    /**
+     * @brief The node group of the calling worker, or NodeCount() if the caller is not a worker of this pool.
+     */
+    std::size_t CurrentNode() const noexcept;
+
+    /**
+     * @brief Tells the pool that the calling worker is about to block (e.g. on I/O
+     * or a future), so it may start a compensating worker if tasks are queued.
+     * Must be paired with EndBlocking(); has no effect outside this pool's workers.
+     */
+    void BeginBlocking();
+    void EndBlocking();
+
+    /**
+     * @brief RAII helper for BeginBlocking()/EndBlocking().
+     */
+    class BlockingScope {
+    public:
+        explicit BlockingScope(SimpleThreadPool& pool) : m_pool(pool) { m_pool.BeginBlocking(); }
+        ~BlockingScope() { m_pool.EndBlocking(); }
+        BlockingScope(const BlockingScope&) = delete;
+        BlockingScope& operator=(const BlockingScope&) = delete;
+    private:
+        SimpleThreadPool& m_pool;
+    };
+
+    /**
+     * @brief Snapshot of the queue statistics of one lane (taken under the queue lock).
+     */
+    LaneStats GetLaneStats(QueueLane lane) const;
+
+    /**
+     * @brief Clears the dispatch counters and wait-time histograms of all lanes.
+     */
+    void ResetLaneStats();
+
+    /**
+     * @brief Aggregates the per-worker metrics (queue wait and run time
+     * histograms, task and wakeup counters) and the current queue depth.
+     * Workers keep running while the snapshot is taken, so counters read
+     * concurrently may be off by the tasks finishing at that moment.
+     * Everything reads as zero when built with SIMPLE_THREAD_POOL_METRICS=0.
+     */
+    PoolMetricsSnapshot GetMetrics() const;
+
+#ifdef SIMPLE_THREAD_POOL_HAS_COROUTINES
+    /**
+     * @brief Awaiter returned by Schedule(); suspends the coroutine and resumes it on a worker.
+     */
+    class ScheduleAwaiter {
+    public:
+        explicit ScheduleAwaiter(SimpleThreadPool& pool) noexcept : m_pool(pool) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { m_pool.Resume(handle, m_priority); }
+        void await_resume() const noexcept {}
+    private:
+        friend class SimpleThreadPool;
+        ScheduleAwaiter(SimpleThreadPool& pool, TaskPriority priority) noexcept :
+            m_pool(pool), m_priority(priority) {}
+        SimpleThreadPool& m_pool;
+        TaskPriority m_priority = TaskPriority::Normal;
+    };
+
+    /**
+     * @brief `co_await pool.Schedule()` continues the current coroutine on a worker thread.
+     * @throws std::runtime_error (at the co_await) if the pool has been stopped.
+     */
+    ScheduleAwaiter Schedule(TaskPriority priority = TaskPriority::Normal) noexcept {
+        return ScheduleAwaiter(*this, priority);
+    }
+
+    /**
+     * @brief Queues a suspended coroutine to be resumed by a worker.
+     * The handle goes into the run queue as-is; no std::function is created.
+     * @throws std::runtime_error if called after the pool has been stopped.
      */
+    void Resume(std::coroutine_handle<> handle, TaskPriority priority = TaskPriority::Normal) {
+        Enqueue(Job{{}, [](void* address) { std::coroutine_handle<>::from_address(address).resume(); },
+                    handle.address()}, LaneOf(priority));
+    }
+#endif
+
+private:
+    // A unit of work in the queue: either a type-erased callable, or a plain
+    // function pointer with an argument (used to resume coroutine handles
+    // without wrapping them in a std::function).
+    struct Job {
+        std::function<void()> fn;
+        void (*raw)(void*) = nullptr;
+        void* arg = nullptr;
+        Clock::time_point enqueued{};
+        Clock::time_point deadline{}; // Only meaningful in the Deadline lane
+
+        void operator()() {
+            if (raw) {
+                raw(arg);
+            } else {
+                fn();
+            }
+        }
+    };
+
+    // Orders the deadline heap so that the earliest deadline is on top.
+    struct DeadlineLater {
+        bool operator()(const Job& a, const Job& b) const { return a.deadline > b.deadline; }
+    };
+
+    static QueueLane LaneOf(TaskPriority priority) noexcept {
+        return static_cast<QueueLane>(static_cast<std::uint8_t>(priority) + 1);
+    }
+
+    // Wraps the task in a packaged_task and hands back its future.
     template<typename Fnc_T>
-    auto Post(Fnc_T task) -> std::future<decltype(task())> {
+    static Job Package(Fnc_T task, std::future<decltype(task())>& future) {
         using ReturnType = decltype(task());
 
         // Wrap the task in a packaged_task to manage its future result.
         // Use shared_ptr for safe lifecycle management when captured by lambda.
         auto packagedTask = std::make_shared<std::packaged_task<ReturnType()>>(std::move(task));
+        future = packagedTask->get_future();
 
-        std::future<ReturnType> future = packagedTask->get_future();
+        // Enqueue a lambda that executes the packaged_task.
+        return Job{[packagedTask]() { (*packagedTask)(); }};
+    }
 
-        {
-            std::unique_lock<std::mutex> lock(mut);
+    // Tasks queued for one node group, plus the workers serving it. Without
+    // NUMA placement the pool has a single group. Protected by mut.
+    struct NodeQueue {
+        // One FIFO per TaskPriority (indexed by QueueLane - 1), plus a min-heap
+        // on deadline for the Deadline lane.
+        std::array<std::deque<Job>, kQueueLaneCount - 1> tasks;
+        std::vector<Job> deadlineTasks;
+        std::size_t queuedCount = 0;
+        std::array<std::uint32_t, kQueueLaneCount> passedOver{}; // Starvation guard, per QueueLane
 
-            // Prevent enqueueing tasks after the pool has been signaled to stop.
-            if (stop) {
-                throw std::runtime_error("Post on stopped SimpleThreadPool");
-            }
+        std::condition_variable condition; // Idle workers of this group wait here
+        std::size_t idleWorkers = 0;
+        std::size_t workerCount = 0;
 
-            // Enqueue a lambda that executes the packaged_task.
-            tasks.emplace([packagedTask]() { (*packagedTask)(); });
-        } // Mutex lock released here
+        std::vector<int> cpus;               // CPUs workers of this group may run on
+        std::vector<std::size_t> stealOrder; // Other groups, nearest first
+    };
 
-        // Notify one waiting worker thread that a new task is available.
-        condition.notify_one();
+    static constexpr std::size_t kAnyNode = static_cast<std::size_t>(-1);
 
-        return future;
-    }
+    void WorkOn(std::size_t node, int cpu);
+    void Enqueue(Job job, QueueLane lane, std::size_t node = kAnyNode);
+    bool PopNextLocked(std::size_t node, Job& job, std::chrono::nanoseconds& waited); // Requires mut
+    bool PopFromLocked(NodeQueue& queue, Job& job, std::chrono::nanoseconds& waited);  // Requires mut
+    void StartWorkerLocked(std::size_t node); // Requires mut
+    void GrowLocked(std::size_t node);        // Requires mut; starts a worker if the bounds allow it
+    void RetireLocked(std::size_t node);      // Requires mut; called by a worker that is about to exit
+    bool SpinForWork() const;                 // Called without mut; true if a task showed up
+    bool HasWorkLocked() const;               // Requires mut; locked lanes or ring non-empty
+    bool RingHasWork() const noexcept { return ring && !ring->EmptyApprox(); }
+    void PushToRing(Job job);
+    bool PopFromRing(Job& job, std::chrono::nanoseconds& waited); // Without mut
+    void OnRingSpace();                       // Wakes producers blocked on a full ring
+    void UpdateLiveWorkersLocked() { liveWorkers.store(threads.size() - blockedWorkers, std::memory_order_relaxed); }
+    void RunJob(Job& job, std::chrono::nanoseconds waited); // Called without mut
+    WorkerMetrics* AcquireMetrics(std::size_t node);
+    void ReleaseMetrics(WorkerMetrics* metrics);
 
+    size_t m_threadCount;
+    std::uint32_t m_starvationLimit;
+    std::size_t m_minThreads;
+    std::size_t m_maxThreads;
+    std::size_t m_growQueueDepth;
+    std::chrono::nanoseconds m_growWaitThreshold;
+    std::chrono::nanoseconds m_idleTimeout;
+    WorkerPlacement m_placement;
+    std::chrono::nanoseconds m_spinTime;
+    std::uint32_t m_yieldCount;
+    CpuTopology m_topology;
+    std::size_t m_nextCpu = 0; // Round-robin cursor for PinToCores
 
-    void Destroy();
+    std::vector<std::thread> threads; // Live workers
+    std::vector<std::thread> retired; // Workers that exited on idle timeout, not yet joined
+    std::size_t idleWorkers = 0;    // Workers waiting for a task, spinning or parked (all groups)
+    std::size_t spinningWorkers = 0; // Idle workers in the spin phase (all groups)
+    std::size_t blockedWorkers = 0; // Workers inside a BlockingScope
 
-private:
-    void WorkOn();
+    std::vector<std::unique_ptr<NodeQueue>> nodes;
+    std::size_t queuedCount = 0; // Tasks queued in all groups
 
-    size_t m_threadCount;
-    std::vector<std::thread> threads;
-    std::queue<std::function<void()>> tasks;
+    // Per-lane statistics, indexed by QueueLane; protected by mut.
+    std::array<LaneStats, kQueueLaneCount> laneStats;
+
+    // Per-worker metrics. Slots are only added or reused under metricsMut
+    // (never under mut), so snapshots do not hold up the queue.
+    mutable std::mutex metricsMut;
+    std::vector<std::unique_ptr<WorkerMetrics>> workerMetrics;
+    std::atomic<std::size_t> queueDepth{0}; // Mirror of queuedCount, readable without mut (spinning workers poll it)
+
+    // LockFreeRing backend. The ring is used without mut; the counters below
+    // let producers decide without mut whether a worker needs waking.
+    std::unique_ptr<BoundedMpmcQueue<Job>> ring;
+    QueueFullPolicy m_fullPolicy;
+    std::atomic<std::size_t> parkedWorkers{0};    // Workers blocked on a node condition
+    std::atomic<std::size_t> liveWorkers{0};      // threads.size() - blockedWorkers
+    std::atomic<std::size_t> ringProducers{0};    // Pushes in flight; Destroy() waits for them
+    std::atomic<std::size_t> blockedProducers{0}; // Producers waiting for a free slot
+    std::atomic<std::uint64_t> ringDispatched{0}; // Normal lane dispatches that did not take mut
+    std::atomic<bool> stopRequested{false};       // Mirror of stop, readable without mut
+    std::mutex spaceMut;                          // Pairs with spaceCondition
+    std::condition_variable spaceCondition;
 
-    std::mutex mut; // Mutex to protect access to tasks queue and stop flag
-    std::condition_variable condition; // Condition variable to signal threads
+    mutable std::mutex mut; // Mutex to protect access to tasks queue and stop flag
     bool stop; // Flag to signal threads to stop execution
 };
 
@@ -0,0 +1,171 @@
+#include "TaskGraph.hpp"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+struct TaskGraph::RunState {
+    std::shared_ptr<const std::vector<Node>> nodes; // Snapshot of the graph being run
+    SimpleThreadPool* pool = nullptr;
+    std::unique_ptr<std::atomic<std::size_t>[]> pending; // Unfinished predecessors per node
+    std::atomic<std::size_t> remaining{0}; // Nodes not yet finished (or skipped)
+    std::atomic<bool> failed{false};
+    std::mutex errorMut;
+    std::exception_ptr error;
+    PoolPromise<void> done;
+};
+
+TaskGraph::TaskGraph() : m_nodes(std::make_shared<std::vector<Node>>()) {}
+
+void TaskGraph::Detach() {
+    // A run in progress holds a reference to the node list; give this graph its own copy.
+    if (m_nodes.use_count() > 1) {
+        m_nodes = std::make_shared<std::vector<Node>>(*m_nodes);
+    }
+}
+
+TaskGraph::NodeId TaskGraph::Add(std::function<void()> task, std::initializer_list<NodeId> dependsOn) {
+    for (NodeId dep : dependsOn) {
+        if (dep >= m_nodes->size()) {
+            throw std::out_of_range("TaskGraph::Add: unknown dependency");
+        }
+    }
+
+    Detach();
+    NodeId id = m_nodes->size();
+    m_nodes->push_back(Node{std::move(task), {}, 0});
+    for (NodeId dep : dependsOn) {
+        Precede(dep, id);
+    }
+    return id;
+}
+
+void TaskGraph::Precede(NodeId before, NodeId after) {
+    if (before >= m_nodes->size() || after >= m_nodes->size()) {
+        throw std::out_of_range("TaskGraph::Precede: unknown node");
+    }
+    Detach();
+    (*m_nodes)[before].successors.push_back(after);
+    ++(*m_nodes)[after].predecessorCount;
+}
+
+void TaskGraph::CheckAcyclic() const {
+    // Kahn's algorithm: every node must become ready at some point.
+    const std::vector<Node>& nodes = *m_nodes;
+    std::vector<std::size_t> pending(nodes.size());
+    std::vector<NodeId> ready;
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+        pending[id] = nodes[id].predecessorCount;
+        if (pending[id] == 0) {
+            ready.push_back(id);
+        }
+    }
+
+    std::size_t visited = 0;
+    while (!ready.empty()) {
+        NodeId id = ready.back();
+        ready.pop_back();
+        ++visited;
+        for (NodeId succ : nodes[id].successors) {
+            if (--pending[succ] == 0) {
+                ready.push_back(succ);
+            }
+        }
+    }
+
+    if (visited != nodes.size()) {
+        throw std::logic_error("TaskGraph contains a cycle");
+    }
+}
+
+PoolFuture<void> TaskGraph::Run(SimpleThreadPool& pool) const {
+    CheckAcyclic();
+
+    auto state = std::make_shared<RunState>();
+    state->nodes = m_nodes;
+    state->pool = &pool;
+    state->done = PoolPromise<void>(&pool);
+    PoolFuture<void> result = state->done.get_future();
+
+    const std::vector<Node>& nodes = *m_nodes;
+    if (nodes.empty()) {
+        state->done.set_value();
+        return result;
+    }
+
+    state->pending.reset(new std::atomic<std::size_t>[nodes.size()]);
+    state->remaining.store(nodes.size(), std::memory_order_relaxed);
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+        state->pending[id].store(nodes[id].predecessorCount, std::memory_order_relaxed);
+    }
+
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].predecessorCount == 0) {
+            Schedule(state, id);
+        }
+    }
+    return result;
+}
+
+void TaskGraph::Schedule(const std::shared_ptr<RunState>& state, NodeId id) {
+    try {
+        state->pool->Execute([state, id]() { RunFrom(state, id); });
+    } catch (...) {
+        // Pool is stopping: record the failure and drain the rest inline (tasks are skipped).
+        {
+            std::lock_guard<std::mutex> lock(state->errorMut);
+            if (!state->error) {
+                state->error = std::current_exception();
+            }
+        }
+        state->failed.store(true, std::memory_order_relaxed);
+        RunFrom(state, id);
+    }
+}
+
+void TaskGraph::RunFrom(const std::shared_ptr<RunState>& state, NodeId id) {
+    const std::vector<Node>& nodes = *state->nodes;
+
+    while (true) {
+        const Node& node = nodes[id];
+        if (!state->failed.load(std::memory_order_relaxed)) {
+            try {
+                node.task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->errorMut);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+                state->failed.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        // Release successors. The first one that becomes ready is continued
+        // on this thread to save a round trip through the queue.
+        constexpr NodeId none = static_cast<NodeId>(-1);
+        NodeId next = none;
+        for (NodeId succ : node.successors) {
+            if (state->pending[succ].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (next == none) {
+                    next = succ;
+                } else {
+                    Schedule(state, succ);
+                }
+            }
+        }
+
+        if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (state->error) {
+                state->done.set_exception(state->error);
+            } else {
+                state->done.set_value();
+            }
+        }
+
+        if (next == none) {
+            return;
+        }
+        id = next;
+    }
+}
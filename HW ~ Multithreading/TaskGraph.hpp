@@ -0,0 +1,70 @@
+#ifndef TASK_GRAPH_HPP
+#define TASK_GRAPH_HPP
+
+#include "SimpleThreadPool.hpp"
+#include "PoolFuture.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A small DAG of tasks executed on a SimpleThreadPool.
+ *
+ * Each node keeps a count of unfinished predecessors. When a node finishes it
+ * decrements the count of each successor; the successor whose count reaches
+ * zero is scheduled right away (one of them is run inline by the same thread),
+ * so no thread ever waits for a dependency.
+ *
+ * If a task throws, the remaining tasks are skipped and the first exception is
+ * delivered through the future returned by Run(). The graph may be modified
+ * or run again while a previous run is in flight: runs share the node list
+ * copy-on-write.
+ */
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    TaskGraph();
+
+    /**
+     * @brief Adds a task that may start as soon as all of dependsOn have finished.
+     * @return Identifier of the new node.
+     * @throws std::out_of_range if a dependency is not a node of this graph.
+     */
+    NodeId Add(std::function<void()> task, std::initializer_list<NodeId> dependsOn = {});
+
+    /**
+     * @brief Adds an edge: `after` starts only once `before` has finished.
+     * @throws std::out_of_range if either node is not part of this graph.
+     */
+    void Precede(NodeId before, NodeId after);
+
+    std::size_t Size() const noexcept { return m_nodes->size(); }
+
+    /**
+     * @brief Starts executing the graph on the pool without blocking.
+     * @return Future that becomes ready when every node has finished.
+     * @throws std::logic_error if the graph contains a cycle.
+     */
+    PoolFuture<void> Run(SimpleThreadPool& pool) const;
+
+private:
+    struct Node {
+        std::function<void()> task;
+        std::vector<NodeId> successors;
+        std::size_t predecessorCount = 0;
+    };
+    struct RunState;
+
+    void Detach();
+    void CheckAcyclic() const;
+    static void Schedule(const std::shared_ptr<RunState>& state, NodeId id);
+    static void RunFrom(const std::shared_ptr<RunState>& state, NodeId id);
+
+    std::shared_ptr<std::vector<Node>> m_nodes;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "TaskGroup.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// A child is run by whoever claims it first: the worker that dequeues its job,
+// or the thread in Wait(). The job left in the queue by a child claimed in
+// Wait() becomes a no-op.
+struct TaskGroup::Child {
+    std::function<void()> task;
+    std::atomic<bool> claimed{false};
+};
+
+struct TaskGroup::State {
+    std::mutex mut; // Protects unstarted and error; pairs with finished
+    std::condition_variable finished;
+    std::vector<std::shared_ptr<Child>> unstarted; // Stack of children, some may already be claimed
+    std::exception_ptr error;
+    std::atomic<std::size_t> pending{0}; // Children not yet finished (or skipped)
+    std::atomic<bool> failed{false};
+
+    void RunChild(Child& child) {
+        if (!failed.load(std::memory_order_relaxed)) {
+            try {
+                child.task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mut);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        child.task = nullptr; // Release the captures now, not when the last reference goes
+
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mut);
+            finished.notify_all();
+        }
+    }
+};
+
+TaskGroup::TaskGroup(SimpleThreadPool& pool) : m_pool(pool), m_state(std::make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        Wait();
+    } catch (...) {
+        // Destructors must not throw; call Wait() to observe child failures.
+    }
+}
+
+void TaskGroup::Spawn(std::function<void()> task) {
+    auto child = std::make_shared<Child>();
+    child->task = std::move(task);
+
+    m_state->pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_state->mut);
+        // Drop children that workers have already claimed from the top of the stack.
+        while (!m_state->unstarted.empty() && m_state->unstarted.back()->claimed.load(std::memory_order_relaxed)) {
+            m_state->unstarted.pop_back();
+        }
+        m_state->unstarted.push_back(child);
+    }
+
+    try {
+        m_pool.Execute([state = m_state, child]() {
+            if (!child->claimed.exchange(true, std::memory_order_acq_rel)) {
+                state->RunChild(*child);
+            }
+        });
+    } catch (const std::runtime_error&) {
+        // Pool is stopping: the child stays on the stack and Wait() runs it.
+    }
+}
+
+void TaskGroup::Wait() {
+    State& state = *m_state;
+    while (true) {
+        // Own children first, newest first.
+        std::shared_ptr<Child> child;
+        {
+            std::lock_guard<std::mutex> lock(state.mut);
+            while (!child && !state.unstarted.empty()) {
+                std::shared_ptr<Child> top = std::move(state.unstarted.back());
+                state.unstarted.pop_back();
+                if (!top->claimed.exchange(true, std::memory_order_acq_rel)) {
+                    child = std::move(top);
+                }
+            }
+        }
+        if (child) {
+            state.RunChild(*child);
+            continue;
+        }
+
+        if (state.pending.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+
+        // The remaining children run on other threads: help with queued work
+        // (which may include their own subtasks) until they are done.
+        if (!m_pool.RunPendingTask()) {
+            std::unique_lock<std::mutex> lock(state.mut);
+            state.finished.wait_for(lock, SimpleThreadPool::kHelpPollInterval,
+                                    [&state] { return state.pending.load(std::memory_order_acquire) == 0; });
+        }
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(state.mut);
+        error = std::exchange(state.error, nullptr);
+    }
+    state.failed.store(false, std::memory_order_relaxed);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef TASK_GROUP_HPP
+#define TASK_GROUP_HPP
+
+#include "SimpleThreadPool.hpp"
+
+#include <functional>
+#include <memory>
+
+/**
+ * @brief Fork-join helper: spawn subtasks with Run(), then join them with Wait().
+ *
+ * Wait() never just blocks a worker. It first runs the group's own children
+ * that no worker has started yet (newest first, so recursion stays
+ * depth-first), then helps with other queued tasks until the children running
+ * elsewhere are done. Recursive divide-and-conquer therefore works on a pool of
+ * any size, e.g.
+ *
+ *   void Walk(SimpleThreadPool& pool, const Dir& dir) {
+ *       TaskGroup group(pool);
+ *       for (const Dir& sub : dir.children) {
+ *           group.Run([&pool, &sub] { Walk(pool, sub); });
+ *       }
+ *       group.Wait();
+ *   }
+ *
+ * If a child throws, children that have not started yet are skipped and Wait()
+ * rethrows the first exception.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(SimpleThreadPool& pool);
+
+    /**
+     * @brief Waits for outstanding children; exceptions not collected by Wait() are discarded.
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Queues a child task on the pool. If the pool has been stopped the
+     * child runs in Wait() instead.
+     */
+    template<typename Fnc_T>
+    void Run(Fnc_T task) {
+        Spawn(std::function<void()>(std::move(task)));
+    }
+
+    /**
+     * @brief Returns once every child has finished, running children (and other
+     * queued tasks) on the calling thread meanwhile. The group can be reused afterwards.
+     * @throws Rethrows the first exception thrown by a child.
+     */
+    void Wait();
+
+private:
+    struct Child;
+    struct State;
+
+    void Spawn(std::function<void()> task);
+
+    SimpleThreadPool& m_pool;
+    std::shared_ptr<State> m_state; // Shared with the queued jobs, which may outlive the group
+};
+
+#endif
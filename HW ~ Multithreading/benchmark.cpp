@@ -0,0 +1,400 @@
+#include "SimpleThreadPool.hpp"
+#include "LatencyHistogram.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput and latency benchmarks for SimpleThreadPool, with std::async as
+// a baseline. Throughput and producer contention are measured for both queue
+// backends (mutex lanes and the lock-free ring). Results are written as a
+// single JSON document.
+//
+//   ./benchmark [--tasks N] [--threads 1,2,4,8] [--producers 1,2,4,8]
+//               [--samples N] [--async-tasks N] [--fanout N] [--rounds N]
+//               [--ring-capacity N] [--out file.json]
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::size_t tasks = 200000;     // Empty tasks per throughput/contention run
+    std::vector<std::size_t> threads{1, 2, 4, 8};
+    std::vector<std::size_t> producers{1, 2, 4, 8};
+    std::size_t samples = 20000;    // Post-to-start latency samples
+    std::size_t asyncTasks = 20000; // std::async starts a thread per task, so use fewer
+    std::size_t fanout = 64;        // Children per fan-out round
+    std::size_t rounds = 2000;      // Fan-out/fan-in rounds
+    std::size_t ringCapacity = 4096;
+    std::string out;                // Empty = stdout
+};
+
+struct Backend {
+    const char* name;
+    QueueBackend queue;
+};
+
+constexpr Backend kBackends[] = {{"locked", QueueBackend::Locked}, {"ring", QueueBackend::LockFreeRing}};
+
+ThreadPoolOptions PoolOptions(const Options& opt, std::size_t threadCount, const Backend& backend) {
+    ThreadPoolOptions options;
+    options.threadCount = threadCount;
+    options.queue = backend.queue;
+    options.ringCapacity = opt.ringCapacity;
+    return options;
+}
+
+// Counts down to zero once; Wait() blocks until it does.
+class Latch {
+public:
+    explicit Latch(std::size_t count) : m_count(count) {}
+
+    void CountDown() {
+        if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(m_mut);
+            m_done = true;
+            m_condition.notify_all();
+        }
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(m_mut);
+        m_condition.wait(lock, [this] { return m_done; });
+    }
+
+private:
+    std::atomic<std::size_t> m_count;
+    std::mutex m_mut;
+    std::condition_variable m_condition;
+    bool m_done = false;
+};
+
+double Seconds(Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+std::uint64_t Nanos(Clock::duration d) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+std::string HistogramJson(const LatencyHistogram& h) {
+    std::ostringstream os;
+    os << "{\"count\": " << h.Count()
+       << ", \"mean_ns\": " << static_cast<std::uint64_t>(h.Mean())
+       << ", \"p50_ns\": " << h.Percentile(50.0)
+       << ", \"p90_ns\": " << h.Percentile(90.0)
+       << ", \"p99_ns\": " << h.Percentile(99.0)
+       << ", \"p999_ns\": " << h.Percentile(99.9)
+       << ", \"max_ns\": " << h.Max() << "}";
+    return os.str();
+}
+
+// Array of one JSON object per line, nested one level in the report.
+std::string ListJson(const std::vector<std::string>& items) {
+    std::ostringstream os;
+    os << "[";
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        os << (i == 0 ? "\n    " : ",\n    ") << items[i];
+    }
+    os << "\n  ]";
+    return os.str();
+}
+
+// --- Empty-task throughput against thread count ---
+
+std::string PoolThroughput(const Options& opt, std::size_t threadCount, const Backend& backend) {
+    SimpleThreadPool pool(PoolOptions(opt, threadCount, backend));
+    Latch done(opt.tasks);
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < opt.tasks; ++i) {
+        pool.Execute([&done]() { done.CountDown(); });
+    }
+    done.Wait();
+    double seconds = Seconds(Clock::now() - start);
+
+    std::ostringstream os;
+    os << "{\"executor\": \"pool\", \"queue\": \"" << backend.name << "\", \"threads\": " << threadCount
+       << ", \"tasks\": " << opt.tasks
+       << ", \"seconds\": " << seconds << ", \"tasks_per_sec\": " << opt.tasks / seconds << "}";
+    return os.str();
+}
+
+std::string AsyncThroughput(const Options& opt) {
+    std::vector<std::future<void>> futures;
+    futures.reserve(opt.asyncTasks);
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < opt.asyncTasks; ++i) {
+        futures.push_back(std::async(std::launch::async, []() {}));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    double seconds = Seconds(Clock::now() - start);
+
+    std::ostringstream os;
+    os << "{\"executor\": \"std::async\", \"threads\": null, \"tasks\": " << opt.asyncTasks
+       << ", \"seconds\": " << seconds << ", \"tasks_per_sec\": " << opt.asyncTasks / seconds << "}";
+    return os.str();
+}
+
+// --- Post-to-start latency ---
+// One task at a time, so every sample includes waking an idle worker.
+
+template <typename Launch>
+LatencyHistogram MeasureStartLatency(std::size_t samples, Launch launch) {
+    LatencyHistogram latency;
+    for (std::size_t i = 0; i < samples; ++i) {
+        auto posted = Clock::now();
+        launch([&latency, posted]() { latency.Record(Nanos(Clock::now() - posted)); }).get();
+    }
+    return latency;
+}
+
+std::string PoolLatency(const Options& opt, std::size_t threadCount) {
+    SimpleThreadPool pool(threadCount);
+    auto latency = MeasureStartLatency(opt.samples, [&pool](auto task) { return pool.Post(task); });
+
+    std::ostringstream os;
+    os << "{\"executor\": \"pool\", \"threads\": " << threadCount << ", \"start_latency\": " << HistogramJson(latency) << "}";
+    return os.str();
+}
+
+std::string AsyncLatency(const Options& opt) {
+    auto latency = MeasureStartLatency(opt.asyncTasks, [](auto task) { return std::async(std::launch::async, task); });
+
+    std::ostringstream os;
+    os << "{\"executor\": \"std::async\", \"threads\": null, \"start_latency\": " << HistogramJson(latency) << "}";
+    return os.str();
+}
+
+// --- Producer contention ---
+// Several threads submit concurrently; measures the cost of the shared queue.
+
+std::string ProducerContention(const Options& opt, std::size_t threadCount, std::size_t producers,
+                               const Backend& backend) {
+    SimpleThreadPool pool(PoolOptions(opt, threadCount, backend));
+    std::size_t perProducer = opt.tasks / producers;
+    Latch done(perProducer * producers);
+    LatencyHistogram postCost; // Time spent inside Execute, per call
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (std::size_t i = 0; i < perProducer; ++i) {
+                auto before = Clock::now();
+                pool.Execute([&done]() { done.CountDown(); });
+                postCost.Record(Nanos(Clock::now() - before));
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.Wait();
+    double seconds = Seconds(Clock::now() - start);
+
+    std::ostringstream os;
+    os << "{\"queue\": \"" << backend.name << "\", \"threads\": " << threadCount << ", \"producers\": " << producers
+       << ", \"tasks\": " << perProducer * producers << ", \"seconds\": " << seconds
+       << ", \"tasks_per_sec\": " << (perProducer * producers) / seconds
+       << ", \"post_cost\": " << HistogramJson(postCost) << "}";
+    return os.str();
+}
+
+// --- Fan-out/fan-in ---
+// Each round a root task spawns `fanout` children and the round ends when
+// the last child finishes.
+
+std::string PoolFanOut(const Options& opt, std::size_t threadCount) {
+    SimpleThreadPool pool(threadCount);
+    LatencyHistogram roundTime;
+
+    auto start = Clock::now();
+    for (std::size_t r = 0; r < opt.rounds; ++r) {
+        auto roundStart = Clock::now();
+        Latch done(opt.fanout);
+        pool.Execute([&pool, &done, &opt]() {
+            for (std::size_t i = 0; i < opt.fanout; ++i) {
+                pool.Execute([&done]() { done.CountDown(); });
+            }
+        });
+        done.Wait();
+        roundTime.Record(Nanos(Clock::now() - roundStart));
+    }
+    double seconds = Seconds(Clock::now() - start);
+
+    std::ostringstream os;
+    os << "{\"executor\": \"pool\", \"threads\": " << threadCount << ", \"fanout\": " << opt.fanout
+       << ", \"rounds\": " << opt.rounds << ", \"rounds_per_sec\": " << opt.rounds / seconds
+       << ", \"round_time\": " << HistogramJson(roundTime) << "}";
+    return os.str();
+}
+
+std::string AsyncFanOut(const Options& opt) {
+    // Every child is a thread, so keep the total comparable to asyncTasks.
+    std::size_t rounds = opt.asyncTasks / opt.fanout;
+    if (rounds == 0) {
+        rounds = 1;
+    }
+    LatencyHistogram roundTime;
+
+    auto start = Clock::now();
+    for (std::size_t r = 0; r < rounds; ++r) {
+        auto roundStart = Clock::now();
+        std::async(std::launch::async, [&opt]() {
+            std::vector<std::future<void>> children;
+            children.reserve(opt.fanout);
+            for (std::size_t i = 0; i < opt.fanout; ++i) {
+                children.push_back(std::async(std::launch::async, []() {}));
+            }
+            for (auto& c : children) {
+                c.get();
+            }
+        }).get();
+        roundTime.Record(Nanos(Clock::now() - roundStart));
+    }
+    double seconds = Seconds(Clock::now() - start);
+
+    std::ostringstream os;
+    os << "{\"executor\": \"std::async\", \"threads\": null, \"fanout\": " << opt.fanout
+       << ", \"rounds\": " << rounds << ", \"rounds_per_sec\": " << rounds / seconds
+       << ", \"round_time\": " << HistogramJson(roundTime) << "}";
+    return os.str();
+}
+
+std::vector<std::size_t> ParseList(const std::string& text) {
+    std::vector<std::size_t> values;
+    std::istringstream is(text);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        std::size_t value = std::stoul(item);
+        if (value == 0) {
+            throw std::invalid_argument("list values must be positive");
+        }
+        values.push_back(value);
+    }
+    return values;
+}
+
+std::size_t ParseCount(const std::string& text) {
+    std::size_t value = std::stoul(text);
+    if (value == 0) {
+        throw std::invalid_argument("counts must be positive");
+    }
+    return value;
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--tasks") {
+            opt.tasks = ParseCount(value);
+        } else if (arg == "--threads") {
+            opt.threads = ParseList(value);
+        } else if (arg == "--producers") {
+            opt.producers = ParseList(value);
+        } else if (arg == "--samples") {
+            opt.samples = ParseCount(value);
+        } else if (arg == "--async-tasks") {
+            opt.asyncTasks = ParseCount(value);
+        } else if (arg == "--fanout") {
+            opt.fanout = ParseCount(value);
+        } else if (arg == "--rounds") {
+            opt.rounds = ParseCount(value);
+        } else if (arg == "--ring-capacity") {
+            opt.ringCapacity = ParseCount(value);
+        } else if (arg == "--out") {
+            opt.out = value;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    try {
+        opt = ParseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark: " << e.what() << "\n"
+                  << "usage: benchmark [--tasks N] [--threads 1,2,4] [--producers 1,4] [--samples N]\n"
+                  << "                 [--async-tasks N] [--fanout N] [--rounds N] [--ring-capacity N]\n"
+                  << "                 [--out file.json]" << std::endl;
+        return 2;
+    }
+
+    std::size_t widest = 1;
+    for (std::size_t t : opt.threads) {
+        widest = t > widest ? t : widest;
+    }
+
+    std::vector<std::string> throughput, latency, contention, fanout;
+    for (std::size_t t : opt.threads) {
+        std::cerr << "throughput/latency/fan-out with " << t << " thread(s)..." << std::endl;
+        for (const Backend& backend : kBackends) {
+            throughput.push_back(PoolThroughput(opt, t, backend));
+        }
+        latency.push_back(PoolLatency(opt, t));
+        fanout.push_back(PoolFanOut(opt, t));
+    }
+    std::cerr << "std::async baseline..." << std::endl;
+    throughput.push_back(AsyncThroughput(opt));
+    latency.push_back(AsyncLatency(opt));
+    fanout.push_back(AsyncFanOut(opt));
+
+    for (std::size_t p : opt.producers) {
+        std::cerr << "producer contention with " << p << " producer(s)..." << std::endl;
+        for (const Backend& backend : kBackends) {
+            contention.push_back(ProducerContention(opt, widest, p, backend));
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+         << "  \"throughput\": " << ListJson(throughput) << ",\n"
+         << "  \"start_latency\": " << ListJson(latency) << ",\n"
+         << "  \"producer_contention\": " << ListJson(contention) << ",\n"
+         << "  \"fan_out_fan_in\": " << ListJson(fanout) << "\n"
+         << "}\n";
+
+    if (opt.out.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream file(opt.out);
+        if (!file) {
+            std::cerr << "benchmark: cannot open " << opt.out << std::endl;
+            return 1;
+        }
+        file << json.str();
+    }
+    return 0;
+}
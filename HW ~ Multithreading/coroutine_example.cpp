@@ -0,0 +1,75 @@
+// Coroutine example for SimpleThreadPool (C++20, see PoolCoroutines.hpp).
+// Built by the Makefile's coroutine_example target with -std=c++20.
+#include "SimpleThreadPool.hpp"
+#include "PoolCoroutines.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Example Coroutines ---
+
+int Square(int x) {
+    return x * x;
+}
+
+// Hops onto a worker, then awaits a PoolFuture without parking any thread.
+PoolTask<int> SquareOnPool(SimpleThreadPool& pool, int x) {
+    co_await pool.Schedule();
+    int squared = co_await pool.Submit([x]() { return Square(x); });
+    co_return squared;
+}
+
+// Awaits a chain of nested tasks and adds up their results.
+PoolTask<int> SumOfSquares(SimpleThreadPool& pool, int n) {
+    co_await pool.Schedule(TaskPriority::High);
+    int sum = 0;
+    for (int i = 1; i <= n; ++i) {
+        sum += co_await SquareOnPool(pool, i);
+    }
+    co_return sum;
+}
+
+PoolTask<void> Report(SimpleThreadPool& pool, std::thread::id caller) {
+    co_await pool.Schedule();
+    std::cout << "Report runs on a worker: " << std::boolalpha << (std::this_thread::get_id() != caller) << std::endl;
+}
+
+PoolTask<int> Failing(SimpleThreadPool& pool) {
+    co_await pool.Schedule();
+    throw std::runtime_error("Something went wrong in a coroutine!");
+    co_return 0;
+}
+
+
+int main() {
+    std::cout << "--- Creating Thread Pool ---" << std::endl;
+    SimpleThreadPool pool(4);
+
+    std::cout << "\n--- Awaiting Task Chains ---" << std::endl;
+    int sum = sync_wait(SumOfSquares(pool, 10));
+    std::cout << "Sum of squares 1..10 = " << sum << " (expected 385)" << std::endl;
+    sync_wait(Report(pool, std::this_thread::get_id()));
+
+    std::cout << "\n--- Exceptions Propagate Through co_await ---" << std::endl;
+    try {
+        sync_wait(Failing(pool));
+        std::cerr << "Missing exception from Failing()" << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cout << "Caught: " << e.what() << std::endl;
+    }
+
+    std::cout << "\n--- One Coroutine After Another ---" << std::endl;
+    std::vector<int> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(sync_wait(SquareOnPool(pool, i)));
+    }
+    bool ok = sum == 385;
+    for (int i = 0; i < 100; ++i) {
+        ok = ok && results[i] == i * i;
+    }
+    std::cout << (ok ? "All results correct" : "Wrong results") << std::endl;
+    return ok ? 0 : 1; // The pool's destructor joins the workers
+}